@@ -0,0 +1,77 @@
+#include <psp2/types.h>
+#include <libk/stdio.h>
+#include "freq.h"
+#include "governor.h"
+#include "datafile.h"
+#include "audit.h"
+
+// Written by the display hook only
+static DC_Audit g_audit[AUDIT_N];
+static volatile uint32_t g_audit_n = 0; // num of decisions recorded this session
+
+void addAudit(const DC_Audit *audit)
+{
+    uint32_t n = g_audit_n;
+
+    g_audit[n % AUDIT_N] = *audit;
+    __sync_synchronize();
+    g_audit_n = n + 1;
+}
+
+// back = 0 is the latest decision, -1 if not recorded (yet or anymore)
+int getAudit(int back, DC_Audit *audit)
+{
+    uint32_t n = g_audit_n;
+    if (back < 0 || back >= AUDIT_N || (uint32_t)back >= n)
+        return -1;
+
+    *audit = g_audit[(n - 1 - back) % AUDIT_N];
+    return 0;
+}
+
+// Plain text, oldest first, ux0:data/DynClockVita/<titleid>_audit.txt
+int saveAudit(const char *titleid)
+{
+    DC_Audit audit[AUDIT_N];
+    char buf[4096];
+    int size = sizeof(buf);
+    int len = 0;
+
+    // Copy while the hook may still write, drop entries it overwrote meanwhile
+    uint32_t n_begin = g_audit_n;
+    __sync_synchronize();
+    for (int i = 0; i < AUDIT_N; i++)
+        audit[i] = g_audit[i];
+    __sync_synchronize();
+    uint32_t n_end = g_audit_n;
+
+    uint32_t first = n_end > AUDIT_N - 1 ? n_end - (AUDIT_N - 1) : 0;
+    uint32_t last = n_begin;
+
+    len += snprintf(buf + len, size - len, "Decisions:        %lu\n", (unsigned long)n_end);
+    for (uint32_t i = first; i < last; i++) {
+        const DC_Audit *a = &audit[i % AUDIT_N];
+
+        len += snprintf(buf + len, size - len,
+                        "\n#%lu %s at %lu us, %s\n"
+                        "  frametime %ld us, target %ld us, trigger %ld us, vblanks %d/%d\n"
+                        "  since up %ld/%ld, since down %ld/%ld frames\n"
+                        "  CPU %d -> %d, BUS %d -> %d, GPU %d -> %d\n",
+                        (unsigned long)i, g_reason_name[a->reason], (unsigned long)a->tick,
+                        a->governor >= 0 ? g_governors[a->governor]->name : "-",
+                        a->frametime, a->frametime_target, a->frametime_trigger,
+                        a->vblank_n, a->vblank_n_target,
+                        a->cooldown.frame_n_since_up, a->cooldown.cooldown_up,
+                        a->cooldown.frame_n_since_down, a->cooldown.cooldown_down,
+                        a->freq_before[CLOCK_CPU], a->freq_after[CLOCK_CPU],
+                        a->freq_before[CLOCK_BUS], a->freq_after[CLOCK_BUS],
+                        a->freq_before[CLOCK_GPU], a->freq_after[CLOCK_GPU]);
+        if (len >= size)
+            break;
+    }
+
+    if (len > size - 1)
+        len = size - 1;
+
+    return writeDataFile(titleid, "_audit.txt", buf, len);
+}
@@ -0,0 +1,25 @@
+#ifndef _AUDIT_H_
+#define _AUDIT_H_
+
+#define AUDIT_N 16
+
+// Why the dynamic path called applyFreq, frame fields are zero for decisions not taken on a frame
+typedef struct {
+    uint32_t tick;                  // process time (us)
+    int reason;                     // DC_Reason
+    int governor;                   // g_governors index, -1 = not a governor decision
+    long frametime;                 // real frametime (us)
+    long frametime_target;          // us
+    long frametime_trigger;         // target + g_drop_frametime_diff (us)
+    int vblank_n;                   // vblanks since previous frame
+    int vblank_n_target;            // vblanks per frame at target FPS, 0 = not vsync based
+    DC_GovernorAudit cooldown;      // deciding governor's cooldowns, zero if none
+    int freq_before[CLOCK_N];       // applied clocks (CPU, BUS, GPU)
+    int freq_after[CLOCK_N];
+} DC_Audit;
+
+void addAudit(const DC_Audit *audit);
+int getAudit(int back, DC_Audit *audit);
+int saveAudit(const char *titleid);
+
+#endif
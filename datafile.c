@@ -0,0 +1,55 @@
+#include <psp2/types.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <libk/stdio.h>
+#include "datafile.h"
+
+static void getDataPath(const char *titleid, const char *suffix, char *path, int size)
+{
+    snprintf(path, size, "%s/%s%s", DATA_DIR, titleid, suffix);
+}
+
+static int putDataFile(const char *titleid, const char *suffix, const void *buf, int len, int flags)
+{
+    char path[64];
+    getDataPath(titleid, suffix, path, sizeof(path));
+
+    sceIoMkdir(DATA_DIR, 0777);
+
+    SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | flags, 0777);
+    if (fd < 0)
+        return fd;
+
+    int ret = sceIoWrite(fd, buf, len);
+    sceIoClose(fd);
+
+    return ret == len ? 0 : -1;
+}
+
+// Num of bytes read, negative if missing
+int readDataFile(const char *titleid, const char *suffix, void *buf, int len)
+{
+    char path[64];
+    getDataPath(titleid, suffix, path, sizeof(path));
+
+    SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+    if (fd < 0)
+        return fd;
+
+    int ret = sceIoRead(fd, buf, len);
+    sceIoClose(fd);
+
+    return ret;
+}
+
+// Replaces the file, 0 on success
+int writeDataFile(const char *titleid, const char *suffix, const void *buf, int len)
+{
+    return putDataFile(titleid, suffix, buf, len, SCE_O_TRUNC);
+}
+
+// Adds to the end of the file, 0 on success
+int appendDataFile(const char *titleid, const char *suffix, const void *buf, int len)
+{
+    return putDataFile(titleid, suffix, buf, len, SCE_O_APPEND);
+}
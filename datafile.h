@@ -0,0 +1,11 @@
+#ifndef _DATAFILE_H_
+#define _DATAFILE_H_
+
+#define DATA_DIR "ux0:data/DynClockVita"
+
+// Files named ux0:data/DynClockVita/<titleid><suffix>
+int readDataFile(const char *titleid, const char *suffix, void *buf, int len);
+int writeDataFile(const char *titleid, const char *suffix, const void *buf, int len);
+int appendDataFile(const char *titleid, const char *suffix, const void *buf, int len);
+
+#endif
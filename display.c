@@ -11,12 +11,16 @@ unsigned int *vram32;
 int pwidth, pheight, bufferwidth;
 uint32_t color = FONT_COLOR;
 
-void updateFramebuf(const SceDisplayFrameBuf *param)
+int updateFramebuf(const SceDisplayFrameBuf *param)
 {
+	int changed = vram32 != param->base;
+
 	pwidth = param->width;
 	pheight = param->height;
 	vram32 = param->base;
 	bufferwidth = param->pitch;
+
+	return changed;
 }
 
 void setTextColor(uint32_t clr)
@@ -24,14 +28,22 @@ void setTextColor(uint32_t clr)
 	color = clr;
 }
 
+// Glyphs are drawn at 2x, skip any that wouldn't fit the framebuffer whole
 void drawCharacter(int character, int x, int y)
 {
-    for (int yy = 0; yy < 10; yy++) {
+    int width = pwidth < bufferwidth ? pwidth : bufferwidth;
+    if (!vram32 || x < 0 || y < 0 ||
+            x + FONT_WIDTH * 2 > width || y + FONT_HEIGHT * 2 > pheight)
+        return;
+
+    character &= 0xFF;
+
+    for (int yy = 0; yy < FONT_HEIGHT; yy++) {
         int xDisplacement = x;
         int yDisplacement = (y + (yy << 1)) * bufferwidth;
         uint32_t *screenPos = (uint32_t *)(vram32 + xDisplacement + yDisplacement);
 
-        uint8_t charPos = font[character * 10 + yy];
+        uint8_t charPos = font[character * FONT_HEIGHT + yy];
         for (int xx = 7; xx >= 2; xx--) {
 			uint32_t clr = ((charPos >> xx) & 1) ? color : 0xFF000000;
 			*(screenPos) = clr;
@@ -45,8 +57,8 @@ void drawCharacter(int character, int x, int y)
 
 void drawString(int x, int y, const char *str)
 {
-    for (size_t i = 0; i < strlen(str); i++)
-        drawCharacter(str[i], x + i * 12, y);
+    for (size_t i = 0; str[i] != '\0'; i++)
+        drawCharacter((unsigned char)str[i], x + i * FONT_WIDTH * 2, y);
 }
 
 void drawStringF(int x, int y, const char *format, ...)
@@ -0,0 +1,136 @@
+#include "freq.h"
+
+// Supported frequencies, sorted (Manual mode)
+int g_freq_step[CLOCK_N][FREQ_STEP_MAX] = {
+    {41, 83, 111, 166, 222, 266, 333, 444}, // CPU
+    {55, 83, 111, 166, 222},                // BUS
+    {41, 55, 83, 111, 166, 222}             // GPU
+};
+int g_freq_step_n[CLOCK_N] = {8, 5, 6};
+
+// Dynamic mode, generated from g_freq_step by buildFreqTable()
+int g_freq_table[FREQ_TABLE_MAX][CLOCK_N];
+int g_freq_table_n = 0;
+
+// Default mode
+int g_freq_default[CLOCK_N] = {
+//  CPU, BUS, GPU
+    333, 166, 166
+};
+// Lowest frequency the dynamic governors go down to
+int g_freq_dynamic_min[CLOCK_N] = {
+//  CPU, BUS, GPU
+    111,  55,  55
+};
+// Relative cost of raising a domain, orders the dynamic ladder
+static int g_freq_cost[CLOCK_N] = {
+//  CPU, BUS, GPU
+    130, 100, 100
+};
+// Estimated power draw per g_freq_step frequency (mW), voltage rises with the top steps
+int g_power_step[CLOCK_N][FREQ_STEP_MAX] = {
+    {60, 110, 140, 210, 280, 340, 450, 700}, // CPU
+    {40,  55,  70, 100, 140},                // BUS
+    {50,  60,  85, 110, 170, 260}            // GPU
+};
+
+int getFreqStep(int index, int freq)
+{
+    int step = 0;
+    while (step < g_freq_step_n[index] - 1 && g_freq_step[index][step] < freq)
+        step++;
+    return step;
+}
+
+// Highest g_freq_step index not above freq
+int getFreqStepMax(int index, int freq)
+{
+    int step = g_freq_step_n[index] - 1;
+    while (step > 0 && g_freq_step[index][step] > freq)
+        step--;
+    return step;
+}
+
+// Lowest ladder row providing at least freq
+int findFreqLadder(int table[][CLOCK_N], int table_n, const int freq[CLOCK_N])
+{
+    for (int row = 0; row < table_n; row++) {
+        if (table[row][CLOCK_CPU] >= freq[CLOCK_CPU] &&
+                table[row][CLOCK_BUS] >= freq[CLOCK_BUS] &&
+                table[row][CLOCK_GPU] >= freq[CLOCK_GPU])
+            return row;
+    }
+    return table_n - 1;
+}
+
+// Highest g_freq_table index not above freq_max
+int getFreqTableMax(const int freq_max[CLOCK_N])
+{
+    for (int row = g_freq_table_n - 1; row > 0; row--) {
+        if (g_freq_table[row][CLOCK_CPU] <= freq_max[CLOCK_CPU] &&
+                g_freq_table[row][CLOCK_BUS] <= freq_max[CLOCK_BUS] &&
+                g_freq_table[row][CLOCK_GPU] <= freq_max[CLOCK_GPU])
+            return row;
+    }
+    return 0;
+}
+
+// Ladder from freq_min to freq_max, domains with freq_min == freq_max stay put
+int buildFreqLadder(const int freq_min[CLOCK_N], const int freq_max[CLOCK_N], int table[][CLOCK_N])
+{
+    int step[CLOCK_N];
+    int step_max[CLOCK_N];
+    int table_n = 0;
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        step_max[i] = getFreqStepMax(i, freq_max[i]);
+        step[i] = getFreqStep(i, freq_min[i]);
+        if (step[i] > step_max[i])
+            step[i] = step_max[i];
+    }
+
+    // Walk from lowest to highest clocks, each row raises the domain
+    // whose next step is cheapest relative to its max frequency
+    while (1) {
+        for (int i = 0; i < CLOCK_N; i++)
+            table[table_n][i] = g_freq_step[i][step[i]];
+        table_n++;
+
+        int next = -1;
+        int next_cost = 0;
+        for (int i = 0; i < CLOCK_N; i++) {
+            if (step[i] >= step_max[i])
+                continue;
+
+            int cost = g_freq_cost[i] * g_freq_step[i][step[i] + 1] / g_freq_step[i][g_freq_step_n[i] - 1];
+            if (next < 0 || cost < next_cost) {
+                next = i;
+                next_cost = cost;
+            }
+        }
+
+        if (next < 0)
+            break;
+        step[next]++;
+    }
+
+    return table_n;
+}
+
+void buildFreqTable()
+{
+    int freq_max[CLOCK_N];
+    for (int i = 0; i < CLOCK_N; i++)
+        freq_max[i] = g_freq_step[i][g_freq_step_n[i] - 1];
+
+    g_freq_table_n = buildFreqLadder(g_freq_dynamic_min, freq_max, g_freq_table);
+}
+
+// Estimated power draw of clocks (mW)
+int estimatePower(const int freq[CLOCK_N])
+{
+    int power = 0;
+    for (int i = 0; i < CLOCK_N; i++)
+        power += g_power_step[i][getFreqStep(i, freq[i])];
+    return power;
+}
@@ -0,0 +1,30 @@
+#ifndef _FREQ_H_
+#define _FREQ_H_
+
+#define FREQ_STEP_MAX       8
+#define FREQ_TABLE_MAX      (FREQ_STEP_MAX * CLOCK_N)
+
+typedef enum {
+	CLOCK_CPU = 0,
+	CLOCK_BUS = 1,
+	CLOCK_GPU = 2,
+	CLOCK_N   = 3
+} DC_ClockIndex;
+
+extern int g_freq_step[CLOCK_N][FREQ_STEP_MAX];
+extern int g_freq_step_n[CLOCK_N];
+extern int g_freq_table[FREQ_TABLE_MAX][CLOCK_N];
+extern int g_freq_table_n;
+extern int g_freq_default[CLOCK_N];
+extern int g_freq_dynamic_min[CLOCK_N];
+extern int g_power_step[CLOCK_N][FREQ_STEP_MAX];
+
+int getFreqStep(int index, int freq);
+int getFreqStepMax(int index, int freq);
+int findFreqLadder(int table[][CLOCK_N], int table_n, const int freq[CLOCK_N]);
+int getFreqTableMax(const int freq_max[CLOCK_N]);
+int buildFreqLadder(const int freq_min[CLOCK_N], const int freq_max[CLOCK_N], int table[][CLOCK_N]);
+void buildFreqTable();
+int estimatePower(const int freq[CLOCK_N]);
+
+#endif
@@ -0,0 +1,733 @@
+#include <stddef.h>
+#include "freq.h"
+#include "governor.h"
+
+long g_drop_frametime_diff       = SECOND * 0.002f; // 2ms - minimal frametime loss for freq bump up
+long g_frame_n_cooldown_up       = 1;               // wait for n frames before bumping up again
+long g_frame_n_cooldown_down     = 120;             // wait for n frames before bumping down again
+long g_input_boost_frame_n       = 0;               // boost clocks for n frames after fresh input, 0 = off
+static int g_input_boost_table_n = 3;               // n of g_freq_table rows to boost by, decays over boost frames
+
+static float g_sensitivity_rate  = 0.3f;            // sensitivity learning rate
+
+static long g_oscillation_frame_n       = 300;      // bump up within n frames of a bump down is an oscillation
+static long g_oscillation_cooldown_max  = 8;        // widen bump down cooldown up to n times
+static long g_oscillation_frame_n_calm  = 3600;     // narrow it back after n frames without oscillation
+
+long g_oscillation_n             = 0;               // num of oscillations detected this session
+
+// Estimated share of a 60 FPS frame spent in each domain at default clocks (%)
+static int g_sensitivity_share[CLOCK_N] = {
+//  CPU, BUS, GPU
+     40,   5,  35
+};
+
+static float g_sensitivity[CLOCK_N]     = {0, 0, 0}; // frametime * MHz spent in each domain
+static float g_sensitivity_min[CLOCK_N] = {0, 0, 0}; // lower bound, a domain never stops mattering
+
+// Input boost, decays over g_input_boost_frame_n frames
+static int decayBoost(long *frame_n_left)
+{
+    if (*frame_n_left <= 0 || g_input_boost_frame_n <= 0)
+        return 0;
+
+    int boost = (g_input_boost_table_n * *frame_n_left + g_input_boost_frame_n - 1) / g_input_boost_frame_n;
+    (*frame_n_left)--;
+    return boost;
+}
+
+// Bump up/down cooldowns, bump down one widens when clocks ping-pong
+typedef struct {
+    long cooldown_down;         // frames to wait before bumping down (adaptive)
+    long frame_n_since_up;
+    long frame_n_since_down;
+    long frame_n_calm;          // num of frames since last oscillation
+    int down;                   // last change was a bump down
+} DC_Hysteresis;
+
+static void resetHysteresis(DC_Hysteresis *hyst)
+{
+    hyst->cooldown_down = g_frame_n_cooldown_down;
+    hyst->frame_n_since_up = 0;
+    hyst->frame_n_since_down = 0;
+    hyst->frame_n_calm = 0;
+    hyst->down = 0;
+}
+
+// Keeps learned cooldown
+static void suspendHysteresis(DC_Hysteresis *hyst)
+{
+    hyst->frame_n_since_up = 0;
+    hyst->frame_n_since_down = 0;
+    hyst->down = 0;
+}
+
+static int canBumpUp(const DC_Hysteresis *hyst)
+{
+    return hyst->frame_n_since_up > g_frame_n_cooldown_up;
+}
+
+static int canBumpDown(const DC_Hysteresis *hyst)
+{
+    return hyst->frame_n_since_up > hyst->cooldown_down &&
+           hyst->frame_n_since_down > hyst->cooldown_down;
+}
+
+// changed: clocks actually went up
+static void bumpUpHysteresis(DC_Hysteresis *hyst, int changed)
+{
+    // Bump down undone shortly after, stay up longer next time
+    if (changed && hyst->down && hyst->frame_n_since_down <= g_oscillation_frame_n) {
+        if (hyst->cooldown_down < g_frame_n_cooldown_down * g_oscillation_cooldown_max)
+            hyst->cooldown_down *= 2;
+        hyst->frame_n_calm = 0;
+        g_oscillation_n++;
+    }
+
+    if (changed)
+        hyst->down = 0;
+    hyst->frame_n_since_up = 0;
+}
+
+// changed: clocks actually went down
+static void bumpDownHysteresis(DC_Hysteresis *hyst, int changed)
+{
+    if (changed)
+        hyst->down = 1;
+    hyst->frame_n_since_down = 0;
+}
+
+static void auditHysteresis(const DC_Hysteresis *hyst, DC_GovernorAudit *audit)
+{
+    audit->frame_n_since_up = hyst->frame_n_since_up;
+    audit->frame_n_since_down = hyst->frame_n_since_down;
+    audit->cooldown_up = g_frame_n_cooldown_up;
+    audit->cooldown_down = hyst->cooldown_down;
+}
+
+static void tickHysteresis(DC_Hysteresis *hyst)
+{
+    hyst->frame_n_since_up++;
+    hyst->frame_n_since_down++;
+
+    // Calm for a while, narrow back towards g_frame_n_cooldown_down
+    if (++hyst->frame_n_calm > g_oscillation_frame_n_calm) {
+        if (hyst->cooldown_down / 2 >= g_frame_n_cooldown_down)
+            hyst->cooldown_down /= 2;
+        else
+            hyst->cooldown_down = g_frame_n_cooldown_down;
+        hyst->frame_n_calm = 0;
+    }
+}
+
+//
+// Ladder, walks g_freq_table one row at a time, only over domains it drives
+//
+static int g_ladder_freq_table[FREQ_TABLE_MAX][CLOCK_N]; // g_freq_table between g_ladder_freq_min and max
+static int g_ladder_freq_table_n     = 0;
+static int g_ladder_freq_min[CLOCK_N] = {0, 0, 0};
+static int g_ladder_freq_max[CLOCK_N] = {0, 0, 0};
+static int g_ladder_table            = 0; // g_ladder_freq_table index
+static int g_ladder_boost            = 0; // n of g_ladder_freq_table rows added by input boost
+static long g_ladder_boost_frame_n   = 0; // num of frames left to boost
+static DC_Hysteresis g_ladder_hyst;
+static DC_GovernorAudit g_ladder_audit;
+
+// Rebuild ladder when pinned domains or ceiling change, keep current clocks if possible
+static int setLadderRange(const int freq_min[CLOCK_N], const int freq_max[CLOCK_N])
+{
+    int freq[CLOCK_N];
+    int changed = 0;
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        changed |= g_ladder_freq_min[i] != freq_min[i] || g_ladder_freq_max[i] != freq_max[i];
+        g_ladder_freq_min[i] = freq_min[i];
+        g_ladder_freq_max[i] = freq_max[i];
+    }
+    if (!changed)
+        return 0;
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        freq[i] = g_ladder_freq_table[g_ladder_table][i];
+        if (freq[i] > freq_max[i])
+            freq[i] = freq_max[i];
+    }
+
+    g_ladder_freq_table_n = buildFreqLadder(freq_min, freq_max, g_ladder_freq_table);
+    g_ladder_table = findFreqLadder(g_ladder_freq_table, g_ladder_freq_table_n, freq);
+    return 1;
+}
+
+static void ladderInit(const DC_GovernorState *state)
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        g_ladder_freq_min[i] = g_freq_dynamic_min[i];
+        g_ladder_freq_max[i] = g_freq_step[i][g_freq_step_n[i] - 1];
+    }
+    g_ladder_freq_table_n = buildFreqLadder(g_ladder_freq_min, g_ladder_freq_max, g_ladder_freq_table);
+    g_ladder_table = findFreqLadder(g_ladder_freq_table, g_ladder_freq_table_n,
+                                    state ? state->freq : g_freq_default);
+    g_ladder_boost = 0;
+    g_ladder_boost_frame_n = 0;
+    resetHysteresis(&g_ladder_hyst);
+}
+
+// Row requested, boost included
+static int getLadderTable()
+{
+    int table = g_ladder_table + g_ladder_boost;
+    return table < g_ladder_freq_table_n - 1 ? table : g_ladder_freq_table_n - 1;
+}
+
+static int ladderOnFrame(const DC_Frame *frame)
+{
+    int table[CLOCK_N];
+    for (int i = 0; i < CLOCK_N; i++)
+        table[i] = g_ladder_freq_table[getLadderTable()][i];
+
+    auditHysteresis(&g_ladder_hyst, &g_ladder_audit);
+
+    int reason = setLadderRange(frame->freq_min, frame->freq_max) ? REASON_RANGE : REASON_NONE;
+
+    // Bump up
+    if (frame->dropped && canBumpUp(&g_ladder_hyst)) {
+        int up = g_ladder_table < g_ladder_freq_table_n - 1;
+        if (up) {
+            g_ladder_table++;
+            reason = REASON_DROP;
+        }
+
+        bumpUpHysteresis(&g_ladder_hyst, up);
+    }
+    // Bump down
+    else if (!frame->dropped && canBumpDown(&g_ladder_hyst)) {
+        int down = g_ladder_table > 0;
+        if (down) {
+            g_ladder_table--;
+            reason = REASON_HEADROOM;
+        }
+
+        bumpDownHysteresis(&g_ladder_hyst, down);
+    }
+
+    g_ladder_boost = decayBoost(&g_ladder_boost_frame_n);
+
+    tickHysteresis(&g_ladder_hyst);
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        if (table[i] != g_ladder_freq_table[getLadderTable()][i])
+            return reason != REASON_NONE ? reason : REASON_BOOST;
+    }
+    return REASON_NONE;
+}
+
+static void ladderOnInput()
+{
+    g_ladder_boost_frame_n = g_input_boost_frame_n;
+}
+
+static void ladderOnSuspend()
+{
+    g_ladder_boost = 0;
+    g_ladder_boost_frame_n = 0;
+    suspendHysteresis(&g_ladder_hyst);
+}
+
+static void ladderSnapshot(DC_GovernorState *state)
+{
+    int table = getLadderTable();
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        state->freq[i] = g_ladder_freq_table[table][i];
+        state->sensitivity[i] = 0;
+    }
+}
+
+static void ladderAudit(DC_GovernorAudit *audit)
+{
+    *audit = g_ladder_audit;
+}
+
+static const DC_Governor g_governor_ladder = {
+    "Ladder",
+    ladderInit,
+    ladderOnFrame,
+    ladderOnInput,
+    ladderOnSuspend,
+    ladderSnapshot,
+    ladderAudit
+};
+
+//
+// Search, lowest power CPU/BUS/GPU combination predicted to meet the target
+//
+static int g_search_step[CLOCK_N]    = {0, 0, 0}; // g_freq_step index (CPU, BUS, GPU)
+static int g_search_step_min[CLOCK_N] = {0, 0, 0}; // g_freq_step index floor (CPU, BUS, GPU)
+static int g_search_step_max[CLOCK_N] = {0, 0, 0}; // g_freq_step index ceiling (CPU, BUS, GPU)
+static int g_search_boost            = 0; // n of g_freq_step steps added by input boost
+static long g_search_boost_frame_n   = 0; // num of frames left to boost
+static long g_search_frametime       = 0; // frametime sum since last search change
+static long g_search_frame_n         = 0; // num of frames since last search change
+static int g_search_probe            = -1; // domain stepped down to probe vsynced headroom, -1 = none
+static int g_search_probe_fail       = -1; // domain whose last probe missed a vblank, -1 = none
+static int g_search_probe_step[CLOCK_N];   // g_search_step before the probe, restored when it misses
+static DC_Hysteresis g_search_hyst;
+static DC_GovernorAudit g_search_audit;
+
+// Frametime predicted by sensitivity model, sum of time spent in each domain
+static float predictFrametime(const int freq[CLOCK_N])
+{
+    float frametime = 0;
+    for (int i = 0; i < CLOCK_N; i++)
+        frametime += g_sensitivity[i] / freq[i];
+    return frametime;
+}
+
+static void resetSensitivity()
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        g_sensitivity[i] = (float)(SECOND / 60) * g_sensitivity_share[i] / 100 * g_freq_default[i];
+        g_sensitivity_min[i] = g_sensitivity[i] / 10;
+    }
+}
+
+// Move model prediction for freq towards frametime (normalized LMS)
+static void updateSensitivity(const int freq[CLOCK_N], float frametime)
+{
+    float x[CLOCK_N];
+    float x_sq = 0;
+    float error = frametime - predictFrametime(freq);
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        x[i] = 1.0f / freq[i];
+        x_sq += x[i] * x[i];
+    }
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        g_sensitivity[i] += g_sensitivity_rate * error * x[i] / x_sq;
+        if (g_sensitivity[i] < g_sensitivity_min[i])
+            g_sensitivity[i] = g_sensitivity_min[i];
+    }
+}
+
+// Learn from frames since last change, vsynced frametimes only bound the real one
+static void observeSensitivity(const DC_Frame *frame)
+{
+    if (g_search_frame_n == 0)
+        return;
+
+    float predicted = predictFrametime(frame->freq);
+    long frametime_trigger = frame->frametime_target + g_drop_frametime_diff;
+
+    if (frame->exact)
+        updateSensitivity(frame->freq, (float)g_search_frametime / g_search_frame_n);
+    else if (frame->dropped && predicted < frametime_trigger)
+        updateSensitivity(frame->freq, frametime_trigger);
+    else if (!frame->dropped && predicted > frame->frametime_target)
+        updateSensitivity(frame->freq, frame->frametime_target);
+}
+
+// Lowest power clocks predicted to fit frametime_max, fastest if none does.
+// Unless freq_now is NULL, only clocks predicted faster than it and lowering
+// no domain are considered, result is left as is when there are none.
+static void searchFreq(long frametime_max, const int freq_now[CLOCK_N], int result[CLOCK_N])
+{
+    int step[CLOCK_N];
+    int step_min[CLOCK_N];
+    int freq[CLOCK_N];
+    int power_best = -1;
+    float frametime_best = 0;
+    float frametime_now = freq_now ? predictFrametime(freq_now) : 0;
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        step_min[i] = g_search_step_min[i];
+        if (freq_now && getFreqStep(i, freq_now[i]) > step_min[i])
+            step_min[i] = getFreqStep(i, freq_now[i]);
+    }
+
+    for (step[CLOCK_CPU] = step_min[CLOCK_CPU]; step[CLOCK_CPU] <= g_search_step_max[CLOCK_CPU]; step[CLOCK_CPU]++) {
+        for (step[CLOCK_BUS] = step_min[CLOCK_BUS]; step[CLOCK_BUS] <= g_search_step_max[CLOCK_BUS]; step[CLOCK_BUS]++) {
+            for (step[CLOCK_GPU] = step_min[CLOCK_GPU]; step[CLOCK_GPU] <= g_search_step_max[CLOCK_GPU]; step[CLOCK_GPU]++) {
+                for (int i = 0; i < CLOCK_N; i++)
+                    freq[i] = g_freq_step[i][step[i]];
+
+                float predicted = predictFrametime(freq);
+                if (freq_now && predicted >= frametime_now)
+                    continue;
+
+                int power = estimatePower(freq);
+                int fits = predicted <= frametime_max;
+                int fits_best = frametime_best <= frametime_max;
+
+                if (power_best < 0 ||
+                        (fits && (!fits_best || power < power_best)) ||
+                        (!fits && !fits_best && predicted < frametime_best)) {
+                    for (int i = 0; i < CLOCK_N; i++)
+                        result[i] = step[i];
+                    power_best = power;
+                    frametime_best = predicted;
+                }
+            }
+        }
+    }
+}
+
+// Domain whose single step down is predicted to slow frames least, the one
+// that missed last is tried only when nothing else is left, -1 if all are at their floor
+static int exploreFreq(int result[CLOCK_N])
+{
+    int freq[CLOCK_N];
+    int best = -1;
+    float frametime_best = 0;
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        if (g_search_step[i] <= g_search_step_min[i])
+            continue;
+
+        for (int c = 0; c < CLOCK_N; c++)
+            freq[c] = g_freq_step[c][g_search_step[c] - (c == i)];
+        float predicted = predictFrametime(freq);
+        if (i == g_search_probe_fail)
+            predicted += SECOND;
+        if (best < 0 || predicted < frametime_best) {
+            best = i;
+            frametime_best = predicted;
+        }
+    }
+
+    for (int i = 0; i < CLOCK_N && best >= 0; i++)
+        result[i] = g_search_step[i] - (i == best);
+    return best;
+}
+
+static int setSearchStep(const int step[CLOCK_N])
+{
+    int changed = 0;
+    for (int i = 0; i < CLOCK_N; i++) {
+        changed |= g_search_step[i] != step[i];
+        g_search_step[i] = step[i];
+    }
+
+    g_search_frametime = 0;
+    g_search_frame_n = 0;
+    return changed;
+}
+
+static void searchInit(const DC_GovernorState *state)
+{
+    resetSensitivity();
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        g_search_step[i] = getFreqStep(i, state ? state->freq[i] : g_freq_default[i]);
+        g_search_step_min[i] = getFreqStep(i, g_freq_dynamic_min[i]);
+        g_search_step_max[i] = g_freq_step_n[i] - 1;
+        // Stale or corrupt profile can't push the model far off the prior
+        if (state && state->sensitivity[i] > g_sensitivity_min[i] &&
+                state->sensitivity[i] < g_sensitivity_min[i] * 1000)
+            g_sensitivity[i] = state->sensitivity[i];
+    }
+
+    g_search_boost = 0;
+    g_search_boost_frame_n = 0;
+    g_search_frametime = 0;
+    g_search_frame_n = 0;
+    g_search_probe = -1;
+    g_search_probe_fail = -1;
+    resetHysteresis(&g_search_hyst);
+}
+
+static int searchOnFrame(const DC_Frame *frame)
+{
+    int step[CLOCK_N];
+    int freq[CLOCK_N];
+    int changed = 0;
+    int reason = REASON_NONE;
+    int boost = g_search_boost;
+
+    auditHysteresis(&g_search_hyst, &g_search_audit);
+
+    g_search_frametime += frame->frametime;
+    g_search_frame_n++;
+
+    // Pinned domains or ceiling moved, stay within them
+    for (int i = 0; i < CLOCK_N; i++) {
+        int step_max = getFreqStepMax(i, frame->freq_max[i]);
+        int step_min = getFreqStep(i, frame->freq_min[i]);
+        if (step_min > step_max)
+            step_min = step_max;
+
+        changed |= step_min != g_search_step_min[i] || step_max != g_search_step_max[i];
+        g_search_step_min[i] = step_min;
+        g_search_step_max[i] = step_max;
+
+        step[i] = g_search_step[i];
+        if (step[i] > step_max)
+            step[i] = step_max;
+        if (step[i] < step_min)
+            step[i] = step_min;
+    }
+    if (changed) {
+        setSearchStep(step);
+        g_search_probe = -1;
+        reason = REASON_RANGE;
+    }
+
+    // Bump up
+    if (frame->dropped && canBumpUp(&g_search_hyst)) {
+        observeSensitivity(frame);
+
+        // Probe missed, back to the clocks that held the target
+        if (g_search_probe >= 0) {
+            for (int i = 0; i < CLOCK_N; i++)
+                step[i] = g_search_probe_step[i];
+            g_search_probe_fail = g_search_probe;
+            g_search_probe = -1;
+        }
+        // Only move to clocks faster than now
+        else {
+            searchFreq(frame->frametime_target - g_drop_frametime_diff, frame->freq, step);
+        }
+        int up = setSearchStep(step);
+
+        bumpUpHysteresis(&g_search_hyst, up);
+        if (up)
+            reason = REASON_DROP;
+    }
+    // Bump down
+    else if (!frame->dropped && canBumpDown(&g_search_hyst)) {
+        int down = 0;
+
+        // Last probe held through the cooldown, every domain may be probed again
+        if (g_search_probe >= 0) {
+            g_search_probe = -1;
+            g_search_probe_fail = -1;
+        }
+
+        observeSensitivity(frame);
+        searchFreq(frame->frametime_target - g_drop_frametime_diff, NULL, step);
+
+        // Only move to clocks cheaper than now
+        for (int i = 0; i < CLOCK_N; i++)
+            freq[i] = g_freq_step[i][step[i]];
+        if (estimatePower(freq) < estimatePower(frame->freq)) {
+            down = setSearchStep(step);
+        }
+        // Vsynced frametimes never show the headroom, probe one step, a missed vblank corrects the model
+        else if (!frame->exact) {
+            for (int i = 0; i < CLOCK_N; i++)
+                g_search_probe_step[i] = g_search_step[i];
+            g_search_probe = exploreFreq(step);
+            if (g_search_probe >= 0)
+                down = setSearchStep(step);
+        }
+
+        bumpDownHysteresis(&g_search_hyst, down);
+        if (down)
+            reason = REASON_HEADROOM;
+    }
+
+    // Boost steps are spread over all domains
+    g_search_boost = (decayBoost(&g_search_boost_frame_n) + CLOCK_N - 1) / CLOCK_N;
+
+    tickHysteresis(&g_search_hyst);
+
+    if (reason == REASON_NONE && boost != g_search_boost)
+        reason = REASON_BOOST;
+    return reason;
+}
+
+static void searchOnInput()
+{
+    g_search_boost_frame_n = g_input_boost_frame_n;
+}
+
+static void searchOnSuspend()
+{
+    g_search_boost = 0;
+    g_search_boost_frame_n = 0;
+    g_search_frametime = 0;
+    g_search_frame_n = 0;
+    g_search_probe = -1;
+    suspendHysteresis(&g_search_hyst);
+}
+
+static void searchSnapshot(DC_GovernorState *state)
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        int step = g_search_step[i] + g_search_boost;
+        if (step > g_search_step_max[i])
+            step = g_search_step_max[i];
+        if (step < g_search_step_min[i])
+            step = g_search_step_min[i];
+
+        state->freq[i] = g_freq_step[i][step];
+        state->sensitivity[i] = g_sensitivity[i];
+    }
+}
+
+static void searchAudit(DC_GovernorAudit *audit)
+{
+    *audit = g_search_audit;
+}
+
+static const DC_Governor g_governor_search = {
+    "Search",
+    searchInit,
+    searchOnFrame,
+    searchOnInput,
+    searchOnSuspend,
+    searchSnapshot,
+    searchAudit
+};
+
+const DC_Governor *g_governors[GOVERNOR_N] = {
+    &g_governor_ladder,
+    &g_governor_search
+};
+
+const char *g_reason_name[REASON_N] = {
+    "none", "drop", "headroom", "boost", "range", "calibration", "loading", "resume",
+    "power cap", "battery", "idle"
+};
+
+//
+// Calibration, perturbs clocks at game start to measure CPU/GPU boundness
+//
+typedef enum {
+	CALIBRATION_OFF  = 0,
+	CALIBRATION_WAIT = 1,
+	CALIBRATION_BASE = 2,
+	CALIBRATION_CPU  = 3,
+	CALIBRATION_GPU  = 4,
+	CALIBRATION_DONE = 5
+} DC_Calibration;
+
+static long g_calibration_frame_n        = 30;              // measure n frames per calibration phase
+static int g_calibration_step_n          = 2;               // n of g_freq_step steps to lower perturbed domain by
+
+int g_calibration_cpu_share                = -1;        // CPU share of CPU+GPU frametime (%), -1 = unknown
+static int g_calibration_phase             = CALIBRATION_OFF;
+static long g_calibration_frame_n_left     = 0;         // num of frames left in current phase
+static long g_calibration_frametime[3]     = {0, 0, 0}; // frametime sum (base, CPU lowered, GPU lowered)
+static int g_calibration_exact             = 0;         // frametimes not bounded by vsync
+static int g_calibration_freq_base[CLOCK_N] = {0, 0, 0};
+static int g_calibration_freq_low[CLOCK_N]  = {0, 0, 0};
+
+// Split modelled CPU+GPU frametime at base clocks by calibrated CPU share
+static void applyCalibration()
+{
+    int freq_cpu = g_calibration_freq_base[CLOCK_CPU];
+    int freq_gpu = g_calibration_freq_base[CLOCK_GPU];
+    float frametime = g_sensitivity[CLOCK_CPU] / freq_cpu + g_sensitivity[CLOCK_GPU] / freq_gpu;
+
+    g_sensitivity[CLOCK_CPU] = frametime * g_calibration_cpu_share / 100 * freq_cpu;
+    g_sensitivity[CLOCK_GPU] = frametime * (100 - g_calibration_cpu_share) / 100 * freq_gpu;
+}
+
+static void finishCalibration()
+{
+    float frametime_base = (float)g_calibration_frametime[0] / g_calibration_frame_n;
+    float sensitivity[CLOCK_N] = {0, 0, 0};
+
+    // Frametime response to lowered clocks, per domain
+    for (int i = CLOCK_CPU; i <= CLOCK_GPU; i += CLOCK_GPU - CLOCK_CPU) {
+        float frametime = (float)g_calibration_frametime[i == CLOCK_CPU ? 1 : 2] / g_calibration_frame_n;
+        float x = 1.0f / g_calibration_freq_low[i] - 1.0f / g_calibration_freq_base[i];
+
+        if (x > 0 && frametime > frametime_base)
+            sensitivity[i] = (frametime - frametime_base) / x;
+    }
+
+    float cpu = sensitivity[CLOCK_CPU] / g_calibration_freq_base[CLOCK_CPU];
+    float gpu = sensitivity[CLOCK_GPU] / g_calibration_freq_base[CLOCK_GPU];
+    if (cpu + gpu <= 0)
+        return;
+
+    // Unsynced frametimes are exact, vsynced ones only tell which domain matters more
+    if (g_calibration_exact) {
+        g_calibration_cpu_share = (int)(100 * cpu / (cpu + gpu));
+        for (int i = CLOCK_CPU; i <= CLOCK_GPU; i += CLOCK_GPU - CLOCK_CPU)
+            g_sensitivity[i] = sensitivity[i] > g_sensitivity_min[i] ? sensitivity[i] : g_sensitivity_min[i];
+    } else {
+        g_calibration_cpu_share = cpu > gpu ? 75 : 25;
+        if (cpu > 0 && gpu > 0)
+            g_calibration_cpu_share = (int)(100 * cpu / (cpu + gpu));
+        applyCalibration();
+    }
+}
+
+void startCalibration(long frame_n_wait)
+{
+    g_calibration_phase = CALIBRATION_WAIT;
+    g_calibration_frame_n_left = frame_n_wait;
+}
+
+// Interrupted calibration starts over
+void suspendCalibration()
+{
+    if (isCalibrating())
+        startCalibration(g_calibration_frame_n);
+}
+
+int isCalibrating()
+{
+    return g_calibration_phase >= CALIBRATION_BASE && g_calibration_phase <= CALIBRATION_GPU;
+}
+
+int isCalibrationPending()
+{
+    return g_calibration_phase != CALIBRATION_OFF && g_calibration_phase != CALIBRATION_DONE;
+}
+
+// frame->freq are clocks before perturbation, nonzero when they should change
+int stepCalibration(const DC_Frame *frame)
+{
+    if (g_calibration_phase == CALIBRATION_WAIT) {
+        if (--g_calibration_frame_n_left > 0)
+            return 0;
+
+        g_calibration_phase = CALIBRATION_BASE;
+        g_calibration_frame_n_left = g_calibration_frame_n;
+        g_calibration_exact = frame->exact;
+        for (int i = 0; i < 3; i++)
+            g_calibration_frametime[i] = 0;
+        return 0;
+    }
+
+    g_calibration_frametime[g_calibration_phase - CALIBRATION_BASE] += frame->frametime;
+    if (--g_calibration_frame_n_left > 0)
+        return 0;
+
+    // Next phase
+    if (g_calibration_phase == CALIBRATION_BASE) {
+        for (int i = 0; i < CLOCK_N; i++)
+            g_calibration_freq_base[i] = frame->freq[i];
+        g_calibration_phase = CALIBRATION_CPU;
+        g_calibration_freq_low[CLOCK_CPU] = getCalibrationFreq(CLOCK_CPU, frame->freq[CLOCK_CPU]);
+    } else if (g_calibration_phase == CALIBRATION_CPU) {
+        g_calibration_phase = CALIBRATION_GPU;
+        g_calibration_freq_low[CLOCK_GPU] = getCalibrationFreq(CLOCK_GPU, frame->freq[CLOCK_GPU]);
+    } else {
+        g_calibration_phase = CALIBRATION_DONE;
+        finishCalibration();
+    }
+
+    g_calibration_frame_n_left = g_calibration_frame_n;
+    return 1;
+}
+
+// Lower the domain being calibrated, not below the dynamic floor
+int getCalibrationFreq(int index, int freq)
+{
+    if ((g_calibration_phase == CALIBRATION_CPU && index == CLOCK_CPU) ||
+            (g_calibration_phase == CALIBRATION_GPU && index == CLOCK_GPU)) {
+        int step_now = getFreqStep(index, freq);
+        int step_min = getFreqStep(index, g_freq_dynamic_min[index]);
+        int step = step_now - g_calibration_step_n;
+        if (step < step_min)
+            step = step_min < step_now ? step_min : step_now;
+        return g_freq_step[index][step];
+    }
+
+    return freq;
+}
@@ -0,0 +1,82 @@
+#ifndef _GOVERNOR_H_
+#define _GOVERNOR_H_
+
+#define SECOND              1000000
+#define CALIBRATION_FRAME_N_WAIT 300 // frames to settle before the calibration sweep
+
+typedef enum {
+	GOVERNOR_LADDER = 0,
+	GOVERNOR_SEARCH = 1,
+	GOVERNOR_N      = 2
+} DC_GovernorIndex;
+
+// Why requested clocks changed
+typedef enum {
+	REASON_NONE        = 0,
+	REASON_DROP        = 1, // missed target, bumped up
+	REASON_HEADROOM    = 2, // met target for cooldown frames, bumped down
+	REASON_BOOST       = 3, // input boost started or decayed
+	REASON_RANGE       = 4, // pinned domains or ceiling moved
+	REASON_CALIBRATION = 5, // calibration sweep moved to its next phase
+	REASON_LOADING     = 6, // loading screen entered or left
+	REASON_RESUME      = 7, // back from idle or suspend
+	REASON_POWER_CAP   = 8, // power cap moved the ceiling
+	REASON_BATTERY     = 9, // battery level or temperature moved the ceiling
+	REASON_IDLE        = 10, // no frames presented for a while
+	REASON_N           = 11
+} DC_Reason;
+
+// Frame as seen by the display hook
+typedef struct {
+    long frametime;         // real frametime (ignore costs of calling sceXXXXX)
+    long frametime_target;
+    int dropped;            // missed vsync or took longer than target
+    int exact;              // frametime not bounded by vsync
+    int freq[CLOCK_N];      // clocks the frame ran at (CPU, BUS, GPU)
+    int freq_min[CLOCK_N];  // floor, equals freq_max for domains the governor doesn't drive
+    int freq_max[CLOCK_N];  // ceiling governors must stay under (CPU, BUS, GPU)
+} DC_Frame;
+
+// Cooldowns as they were when on_frame last decided
+typedef struct {
+    long frame_n_since_up;
+    long frame_n_since_down;
+    long cooldown_up;
+    long cooldown_down;         // adaptive, widened by oscillations
+} DC_GovernorAudit;
+
+// Everything needed to warm start a governor
+typedef struct {
+    int freq[CLOCK_N];          // requested clocks (CPU, BUS, GPU)
+    float sensitivity[CLOCK_N]; // frametime * MHz spent in each domain, 0 = unknown
+} DC_GovernorState;
+
+typedef struct {
+    const char *name;
+    void (*init)(const DC_GovernorState *state); // NULL state starts at default clocks
+    int (*on_frame)(const DC_Frame *frame);      // DC_Reason when requested clocks changed, else 0
+    void (*on_input)(void);
+    void (*on_suspend)(void);                    // loading, idle or sleep, drop transient state
+    void (*snapshot)(DC_GovernorState *state);
+    void (*audit)(DC_GovernorAudit *audit);
+} DC_Governor;
+
+extern const DC_Governor *g_governors[GOVERNOR_N];
+extern const char *g_reason_name[REASON_N];
+
+extern long g_drop_frametime_diff;
+extern long g_frame_n_cooldown_up;
+extern long g_frame_n_cooldown_down;
+extern long g_input_boost_frame_n;
+extern long g_oscillation_n;
+
+extern int g_calibration_cpu_share;
+
+void startCalibration(long frame_n_wait);
+void suspendCalibration();
+int isCalibrating();
+int isCalibrationPending();
+int stepCalibration(const DC_Frame *frame);
+int getCalibrationFreq(int index, int freq);
+
+#endif
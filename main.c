@@ -1,300 +1,703 @@
 #include <psp2/kernel/modulemgr.h>
 #include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
 #include <psp2/display.h>
 #include <psp2/ctrl.h>
 #include <psp2/power.h>
+#include <psp2/appmgr.h>
 #include <taihen.h>
 #include <stdio.h>
 
 #include "display.h"
-
-#define SECOND              1000000
-
-#define FREQ_STEP_GPU_BUS_N 4
-#define FREQ_STEP_CPU_N     2
-#define FREQ_TABLE_N        5
-
-#define FRAMETIME_STABLE_FRAMES_N 5
-
-#define COLOR_TEXT_SELECT 0x004444FF
-#define COLOR_TEXT        0x00FFFFFF
-
-typedef enum {
-	CLOCK_CPU = 0,
-	CLOCK_BUS = 1,
-	CLOCK_GPU = 2,
-	CLOCK_N   = 3
-} DC_ClockIndex;
-
-typedef enum {
-	MODE_DYNAMIC = 0,
-	MODE_DEFAULT = 1,
-	MODE_MANUAL  = 2,
-	MODE_N       = 3
-} DC_Mode;
-
-typedef enum {
-	MENU_HIDDEN  = 0,
-	MENU_MINIMAL = 1,
-	MENU_FULL    = 2,
-	MENU_N       = 3
-} DC_Menu;
-
-// Manual mode
-static int g_freq_step_gpu_bus[FREQ_STEP_GPU_BUS_N] = {
-    55,
-    111,
-    166,
-    222
-};
-static int g_freq_step_cpu[FREQ_STEP_CPU_N] = {
-    333,
-    444
+#include "freq.h"
+#include "governor.h"
+#include "profile.h"
+#include "report.h"
+#include "perf.h"
+#include "trace.h"
+#include "audit.h"
+#include "pace.h"
+#include "menu.h"
+
+#define WATCHDOG_INTERVAL   (SECOND / 4)
+#define WATCHDOG_STACK_SIZE 0x4000 // audit, report and perf are formatted on it
+#define BATTERY_INTERVAL    (SECOND * 10)
+#define BATTERY_HOT_TEMP_MIN 35 // C, profile values outside are ignored
+#define BATTERY_HOT_TEMP_MAX 60
+
+#define FB_FLIP_WINDOW_N    60
+
+#define PROFILE_SAVE_INTERVAL (SECOND * 60)
+#define PROFILE_FRAME_N_MIN   600
+
+// Loading phase (Dynamic mode)
+static int g_freq_loading[CLOCK_N] = {
+//  CPU, BUS, GPU
+    444, 111,  55
 };
 
-// Dynamic mode
-static int g_freq_table[FREQ_TABLE_N][CLOCK_N] = {
-//   CPU, BUS, GPU
-    {333,  55,  55},
-    {333, 111, 111},
-    {333, 166, 166},
-    {333, 222, 222},
-    {444, 222, 222}
-};
-// Default mode
-static int g_freq_default[CLOCK_N] = {
+// Battery low, charging lifts it (Dynamic mode)
+static int g_freq_battery_low[CLOCK_N] = {
 //  CPU, BUS, GPU
     333, 166, 166
 };
+// Battery critical, charging lifts it (Dynamic mode)
+static int g_freq_battery_critical[CLOCK_N] = {
+//  CPU, BUS, GPU
+    222, 111, 111
+};
 
-static int g_freq_current_table         = 2;         // g_freq_table index (Dynamic mode)
-static int g_freq_current_step[CLOCK_N] = {0, 0, 0}; // g_freq_step_xxx index (CPU, BUS, GPU) (Manual mode)
+static int g_fb_multi_buffered    = 0; // game flips between several framebuffers
+static int g_fb_flip_n            = 0; // num of flips in current framebuffer window
+static int g_fb_change_n          = 0; // num of framebuffer base changes in current window
+
+static int g_calibration                 = 1;               // perturb clocks at game start to measure CPU/GPU boundness
+
+static char g_titleid[16]                           = {0};
+static long g_profile_frame_n                       = 0; // num of governed frames this session
+static long g_profile_step_frame_n[CLOCK_N][FREQ_STEP_MAX] = {{0}}; // num of governed frames per g_freq_step index
+
+static int g_energy_power                  = 0; // estimated power draw of applied clocks (mW)
+static SceUInt32 g_energy_tick             = 0; // tick energy was last accumulated at
+static long long g_energy                  = 0; // estimated energy this session (uJ)
+static long long g_energy_duration         = 0; // session time energy was accumulated over (us)
+static long g_energy_frame_n               = 0; // num of presented frames this session
+
+static int g_freq_applied[CLOCK_N]         = {0, 0, 0}; // clocks last passed to scePowerSetXXXClockFrequency
+static long g_freq_transition_n            = 0; // num of applied clock changes this session
+static int g_audit_save                    = 0; // decision log requested from menu, written by watchdog thread
+static DC_Audit g_audit_idle[IDLE_N];           // idle decisions of watchdog thread, per DC_Idle stage
+static volatile int g_audit_idle_pending   = 0; // bits of g_audit_idle the display hook has yet to record
+static volatile int g_freq_writer          = 0; // a thread is applying clocks or accumulating energy
+static volatile int g_freq_pending         = 0; // applyFreq called while another thread was at it
+
+static long g_power_cap_window             = SECOND * 2;   // measure average power over n us before moving the ceiling
+static int g_power_avg                     = 0; // smoothed average power over last windows (mW)
+static int g_power_cap_table               = 0; // g_freq_table index ceiling (Dynamic mode)
+static long long g_power_cap_energy        = 0; // g_energy at window start
+static long long g_power_cap_duration      = 0; // g_energy_duration at window start
+
+static int g_battery_low_percent           = PROFILE_BATTERY_LOW_PERCENT;      // battery % capping clocks at g_freq_battery_low
+static int g_battery_critical_percent      = PROFILE_BATTERY_CRITICAL_PERCENT; // battery % capping clocks at g_freq_battery_critical
+static int g_battery_hot_temp              = PROFILE_BATTERY_HOT_TEMP;         // battery temperature (C) stepping the ceiling down
+static int g_battery_hot_temp_diff         = 3;            // cool down by n C before stepping back up
+static int g_battery_table                 = 0; // g_freq_table index ceiling for battery level
+static int g_battery_hot_table             = 0; // g_freq_table index ceiling for battery temperature
+static volatile int g_battery_changed      = 0; // battery ceilings moved, display thread rebuilds g_freq_max
+
+static int g_freq_max[CLOCK_N]             = {0, 0, 0}; // lowest of all ceilings (CPU, BUS, GPU) (Dynamic mode)
 
-static int g_mode[MODE_N] = {MODE_DYNAMIC, MODE_DYNAMIC, MODE_DYNAMIC}; // (CPU, BUS, GPU)
-static int g_menu         = MENU_HIDDEN;
+static SceUID g_hook[8];
+static tai_hook_ref_t g_hook_ref[8];
 
+static SceUID g_thread_uid = -1;
+static int g_thread_run    = 0;
 
-static long g_frametime_target    = 33333;
-static long g_frametime_stable    = 33333;
-static int g_frametime_stable_n   = 0;
+// Clocks requested by governor, before calibration perturbs them
+int getGovernorFreq(int governor, int index)
+{
+    DC_GovernorState state;
+    g_governors[governor]->snapshot(&state);
+    return state.freq[index];
+}
 
-static int g_fps_stable           = 30;
-static int g_fps_target_stable    = 30;
+int getConfigFreq(const DC_Config *config, int index)
+{
+    // Dynamic
+    if (config->mode[index] == MODE_DYNAMIC) {
+        if (g_idle == IDLE_DEEP)
+            return g_freq_table[0][index];
+
+        // Many games stop presenting while loading, race short gaps like a loading screen
+        int freq = g_loading || g_idle ? g_freq_loading[index] :
+                   getCalibrationFreq(index, getGovernorFreq(config->governor[index], index));
+        return freq < g_freq_max[index] ? freq : g_freq_max[index];
+    }
+    // Default
+    else if (config->mode[index] == MODE_DEFAULT)
+        return g_freq_default[index];
+    // Manual
+    else
+        return g_freq_step[index][config->freq_current_step[index]];
+}
+
+// Display thread only, other threads go through readConfig
+int getFreq(int index)
+{
+    return getConfigFreq(&g_config, index);
+}
 
-static SceUInt32 g_tick_last      = 1; // tick of last frame
-static SceUInt32 g_tick_real_last = 1; // real tick of last frame (ignore costs of calling sceXXXXX)
-static long g_frame_n_since_up    = 0; // num of frames since last freq change
-static long g_frame_n_since_down  = 0;
+int tryLockFreq()
+{
+    return __sync_bool_compare_and_swap(&g_freq_writer, 0, 1);
+}
 
-static long g_drop_frametime_diff        = SECOND * 0.002f; // 2ms - minimal frametime loss for freq bump up
-static long g_frame_n_cooldown_up        = 1;               // wait for n frames before bumping up again
-static long g_frame_n_cooldown_down      = 120;             // wait for n frames before bumping down again
+void unlockFreq()
+{
+    __sync_lock_release(&g_freq_writer);
+}
 
-static long g_buttons_old = 0;
-static int g_selected     = 0;
+// Integrate power of clocks applied since last call
+void accumulateEnergy()
+{
+    SceUInt32 tick_now = sceKernelGetProcessTimeLow();
+    SceUInt32 elapsed = tick_now - g_energy_tick;
 
-static SceUID g_hook[8];
-static tai_hook_ref_t g_hook_ref[8];
+    g_energy += (long long)g_energy_power * elapsed / 1000;
+    g_energy_duration += elapsed;
+    g_energy_tick = tick_now;
+}
 
-int getFreq(int index)
+void writeFreq()
 {
-    // Dynamic
-    if (g_mode[index] == MODE_DYNAMIC)
-        return g_freq_table[g_freq_current_table][index];
-    // Default
-    else if (g_mode[index] == MODE_DEFAULT)
-        return g_freq_default[index];
-    // Manual
-    else {
-        if (index == CLOCK_CPU)
-            return g_freq_step_cpu[g_freq_current_step[index]];
-        else
-            return g_freq_step_gpu_bus[g_freq_current_step[index]];
+    DC_Config config;
+    readConfig(&config);
+
+    int freq[CLOCK_N] = {getConfigFreq(&config, CLOCK_CPU),
+                         getConfigFreq(&config, CLOCK_BUS),
+                         getConfigFreq(&config, CLOCK_GPU)};
+
+    accumulateEnergy();
+    g_energy_power = estimatePower(freq);
+
+    if (freq[CLOCK_CPU] != g_freq_applied[CLOCK_CPU] ||
+            freq[CLOCK_BUS] != g_freq_applied[CLOCK_BUS] ||
+            freq[CLOCK_GPU] != g_freq_applied[CLOCK_GPU]) {
+        for (int i = 0; i < CLOCK_N; i++)
+            g_freq_applied[i] = freq[i];
+        g_freq_transition_n++;
     }
+
+    scePowerSetArmClockFrequency(freq[CLOCK_CPU]);
+    scePowerSetBusClockFrequency(freq[CLOCK_BUS]);
+    scePowerSetGpuClockFrequency(freq[CLOCK_GPU]);
 }
 
+// Any thread, one writer at a time, a busy writer applies again on the caller's behalf
 void applyFreq()
 {
-    scePowerSetArmClockFrequency(getFreq(CLOCK_CPU));
-    scePowerSetBusClockFrequency(getFreq(CLOCK_BUS));
-    scePowerSetGpuClockFrequency(getFreq(CLOCK_GPU));
+    g_freq_pending = 1;
+    __sync_synchronize();
+
+    while (g_freq_pending && tryLockFreq()) {
+        g_freq_pending = 0;
+        writeFreq();
+        unlockFreq();
+        __sync_synchronize();
+    }
+}
+
+// Lowest of power cap and battery ceilings
+void updateFreqMax()
+{
+    int table = g_power_cap_table;
+    if (g_battery_table < table)
+        table = g_battery_table;
+    if (g_battery_hot_table < table)
+        table = g_battery_hot_table;
+
+    for (int i = 0; i < CLOCK_N; i++)
+        g_freq_max[i] = g_freq_table[table][i];
+}
+
+void setPowerCapTable(int table)
+{
+    g_power_cap_table = table;
+    updateFreqMax();
+}
+
+// Polled from watchdog thread, keeps sceDisplaySetFrameBuf_patched free of it
+void updateBatteryCeiling()
+{
+    int percent = scePowerGetBatteryLifePercent();
+    int temp = scePowerGetBatteryTemp() / 100; // 0.01 C
+    int table = g_battery_table;
+    int hot_table = g_battery_hot_table;
+
+    if (scePowerIsBatteryCharging())
+        table = g_freq_table_n - 1;
+    else if (percent >= 0 && percent <= g_battery_critical_percent)
+        table = getFreqTableMax(g_freq_battery_critical);
+    else if (percent >= 0 && percent <= g_battery_low_percent)
+        table = getFreqTableMax(g_freq_battery_low);
+    else
+        table = g_freq_table_n - 1;
+
+    // Step down while hot, back up once cooled
+    if (temp >= g_battery_hot_temp && hot_table > 0)
+        hot_table--;
+    else if (temp < g_battery_hot_temp - g_battery_hot_temp_diff && hot_table < g_freq_table_n - 1)
+        hot_table++;
+
+    if (table != g_battery_table || hot_table != g_battery_hot_table) {
+        g_battery_table = table;
+        g_battery_hot_table = hot_table;
+        __sync_synchronize();
+        g_battery_changed = 1;
+    }
+}
+
+// Start from highest row estimated to fit the cap on its own
+void resetPowerCap()
+{
+    int table = g_freq_table_n - 1;
+    if (g_config.power_cap > 0) {
+        while (table > 0 && estimatePower(g_freq_table[table]) > g_config.power_cap)
+            table--;
+    }
+
+    g_power_avg = 0;
+    g_power_cap_energy = g_energy;
+    g_power_cap_duration = g_energy_duration;
+    setPowerCapTable(table);
+}
+
+// Move ceiling one row per window to keep average power under g_config.power_cap, 1 if it moved
+int updatePowerCap()
+{
+    long long duration = g_energy_duration - g_power_cap_duration;
+    if (g_config.power_cap == 0 || duration < g_power_cap_window)
+        return 0;
+
+    int power = (int)((g_energy - g_power_cap_energy) * 1000 / duration);
+    g_power_avg = g_power_avg > 0 ? (g_power_avg + power) / 2 : power;
+    g_power_cap_energy = g_energy;
+    g_power_cap_duration = g_energy_duration;
+
+    int table = g_power_cap_table;
+    if (g_power_avg > g_config.power_cap && table > 0) {
+        table--;
+    } else if (table < g_freq_table_n - 1) {
+        // Room for the next row even if it ran all the time
+        int power_up = estimatePower(g_freq_table[table + 1]) - estimatePower(g_freq_table[table]);
+        if (g_power_avg + power_up <= g_config.power_cap)
+            table++;
+    }
+
+    if (table == g_power_cap_table)
+        return 0;
+
+    setPowerCapTable(table);
+    applyFreq();
+    return 1;
+}
+
+// Governors driving at least one domain
+int isGovernorUsed(int governor)
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        if (g_config.mode[i] == MODE_DYNAMIC && g_config.governor[i] == governor)
+            return 1;
+    }
+    return 0;
+}
+
+// Calibration only serves Search, starts once a domain is switched to it
+void updateCalibration()
+{
+    if (!isGovernorUsed(GOVERNOR_SEARCH))
+        suspendCalibration();
+    else if (g_calibration && g_calibration_cpu_share < 0 && !isCalibrationPending())
+        startCalibration(CALIBRATION_FRAME_N_WAIT);
 }
 
-void checkButtons(SceCtrlData *ctrl)
+void resetGovernor()
 {
-    unsigned long pressed = ctrl->buttons & ~g_buttons_old;
+    for (int i = 0; i < GOVERNOR_N; i++)
+        g_governors[i]->on_suspend();
+    suspendCalibration();
+}
 
-    // Toggle menu
-    if (ctrl->buttons & SCE_CTRL_SELECT) {
-        if (g_menu < MENU_FULL && (pressed & SCE_CTRL_UP)) {
-            g_menu++;
+void getAppliedFreq(int freq[CLOCK_N])
+{
+    for (int i = 0; i < CLOCK_N; i++)
+        freq[i] = g_freq_applied[i];
+}
+
+int isAppliedFreq(const int freq[CLOCK_N])
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        if (freq[i] != g_freq_applied[i])
+            return 0;
+    }
+    return 1;
+}
+
+// Decision not taken on a frame (ceilings, idle), frame fields left empty
+void initAudit(DC_Audit *audit, SceUInt32 tick, int reason, const int freq_before[CLOCK_N])
+{
+    DC_GovernorAudit cooldown_none = {0, 0, 0, 0};
+    audit->tick = tick;
+    audit->reason = reason;
+    audit->governor = -1;
+    audit->frametime = 0;
+    audit->frametime_target = 0;
+    audit->frametime_trigger = 0;
+    audit->vblank_n = 0;
+    audit->vblank_n_target = 0;
+    audit->cooldown = cooldown_none;
+    for (int i = 0; i < CLOCK_N; i++) {
+        audit->freq_before[i] = freq_before[i];
+        audit->freq_after[i] = g_freq_applied[i];
+    }
+}
+
+// Warm start governors from last session
+void loadTitleProfile()
+{
+    DC_Profile profile;
+    DC_GovernorState state;
+    DC_GovernorState *warm = NULL;
+
+    if (g_titleid[0] != '\0' && loadProfile(g_titleid, &profile) == 0) {
+        for (int i = 0; i < CLOCK_N; i++) {
+            state.freq[i] = profile.freq[i];
+            state.sensitivity[i] = profile.sensitivity[i];
+            if (profile.governor[i] >= 0 && profile.governor[i] < GOVERNOR_N)
+                g_config.governor[i] = profile.governor[i];
+        }
+        warm = &state;
+
+        if (profile.fps_target > 0 && profile.fps_target <= VBLANK_RATE) {
+            g_fps_target_stable = profile.fps_target;
+            g_frametime_target = SECOND / g_fps_target_stable;
         }
-        else if (g_menu > MENU_HIDDEN && (pressed & SCE_CTRL_DOWN)) {
-            g_menu--;
+        if (profile.calibration_cpu_share >= -1 && profile.calibration_cpu_share <= 100)
+            g_calibration_cpu_share = profile.calibration_cpu_share;
+
+        // Zeroed or corrupt values would cap or step down clocks from the first poll
+        if (profile.battery_critical_percent >= 0 &&
+                profile.battery_critical_percent <= profile.battery_low_percent &&
+                profile.battery_low_percent <= 100) {
+            g_battery_low_percent = profile.battery_low_percent;
+            g_battery_critical_percent = profile.battery_critical_percent;
         }
+        if (profile.battery_hot_temp >= BATTERY_HOT_TEMP_MIN && profile.battery_hot_temp <= BATTERY_HOT_TEMP_MAX)
+            g_battery_hot_temp = profile.battery_hot_temp;
+
+        // Tuned offline (tools/tune.c)
+        if (profile.drop_frametime_diff > 0)
+            g_drop_frametime_diff = profile.drop_frametime_diff;
+        if (profile.frame_n_cooldown_up > 0)
+            g_frame_n_cooldown_up = profile.frame_n_cooldown_up;
+        if (profile.frame_n_cooldown_down > 0)
+            g_frame_n_cooldown_down = profile.frame_n_cooldown_down;
     }
 
-    // Full menu open
-    if (g_menu == MENU_FULL) {
-        // Move up/down in menu
-        if (g_selected > CLOCK_CPU && (pressed & SCE_CTRL_UP))
-            g_selected--;
-        else if (g_selected < CLOCK_GPU && (pressed & SCE_CTRL_DOWN))
-            g_selected++;
-
-        if (pressed & SCE_CTRL_RIGHT) {
-            // Dynamic, Default
-            if (g_mode[g_selected] < MODE_MANUAL) {
-                g_mode[g_selected]++;
-
-                // Reset clocks
-                if (g_mode[g_selected] == MODE_MANUAL)
-                    g_freq_current_step[g_selected] = 0;
-            // Manual
-            } else if (g_mode[g_selected] == MODE_MANUAL) {
-                // Freq up
-                if ((g_selected == CLOCK_CPU && g_freq_current_step[g_selected] < FREQ_STEP_CPU_N - 1) ||
-                   ((g_selected == CLOCK_BUS || g_selected == CLOCK_GPU) && g_freq_current_step[g_selected] < FREQ_STEP_GPU_BUS_N - 1))
-                    g_freq_current_step[g_selected]++;
-            }
+    for (int i = 0; i < GOVERNOR_N; i++)
+        g_governors[i]->init(warm);
+}
 
-            applyFreq();
+void saveTitleProfile()
+{
+    DC_Profile profile;
+    DC_GovernorState state;
+    DC_Config config;
+
+    // Not enough to learn from
+    if (g_titleid[0] == '\0' || g_profile_frame_n < PROFILE_FRAME_N_MIN)
+        return;
+
+    profile.magic = PROFILE_MAGIC;
+    profile.version = PROFILE_VERSION;
+
+    // Most used clocks
+    readConfig(&config);
+    g_governors[GOVERNOR_SEARCH]->snapshot(&state);
+    for (int i = 0; i < CLOCK_N; i++) {
+        int step_best = 0;
+        for (int step = 1; step < g_freq_step_n[i]; step++) {
+            if (g_profile_step_frame_n[i][step] > g_profile_step_frame_n[i][step_best])
+                step_best = step;
         }
+        profile.freq[i] = g_freq_step[i][step_best];
+        profile.governor[i] = config.governor[i];
+        profile.sensitivity[i] = state.sensitivity[i];
+    }
 
-        if (pressed & SCE_CTRL_LEFT) {
-            // Default (1) -> Dynamic (0)
-            if (g_mode[g_selected] == MODE_DEFAULT)
-                g_mode[g_selected]--;
-            // Manual (2)
-            else if (g_mode[g_selected] == MODE_MANUAL) {
-                // -> Default (1)
-                if (g_freq_current_step[g_selected] == 0)
-                    g_mode[g_selected]--;
-                // Freq down
-                else if (g_freq_current_step[g_selected] > 0)
-                    g_freq_current_step[g_selected]--;
-            }
+    profile.fps_target = g_fps_target_stable;
+    profile.calibration_cpu_share = g_calibration_cpu_share;
+    profile.battery_low_percent = g_battery_low_percent;
+    profile.battery_critical_percent = g_battery_critical_percent;
+    profile.battery_hot_temp = g_battery_hot_temp;
+    profile.drop_frametime_diff = g_drop_frametime_diff;
+    profile.frame_n_cooldown_up = g_frame_n_cooldown_up;
+    profile.frame_n_cooldown_down = g_frame_n_cooldown_down;
 
-            applyFreq();
-        }
+    saveProfile(g_titleid, &profile);
+}
+
+void saveTitleReport()
+{
+    DC_Report report;
+
+    if (g_titleid[0] == '\0')
+        return;
+
+    if (tryLockFreq()) {
+        accumulateEnergy();
+        unlockFreq();
     }
 
-    g_buttons_old = ctrl->buttons;
+    report.duration = g_energy_duration;
+    report.energy = g_energy;
+    report.frame_n = g_energy_frame_n;
+    report.fps_target = g_fps_target_stable;
+    report.transition_n = g_freq_transition_n;
+    report.oscillation_n = g_oscillation_n;
+    for (int i = 0; i < CLOCK_N; i++) {
+        for (int step = 0; step < FREQ_STEP_MAX; step++)
+            report.step_frame_n[i][step] = g_profile_step_frame_n[i][step];
+    }
+
+    saveReport(g_titleid, &report);
+}
+
+// Display thread, menu changes take the same single writer path as the governors
+void applyMenu(int event)
+{
+    if (event & MENU_EVENT_AUDIT)
+        g_audit_save = 1;
+    if (event & MENU_EVENT_POWER_CAP)
+        resetPowerCap();
+    if (event & (MENU_EVENT_APPLY | MENU_EVENT_POWER_CAP)) {
+        updateCalibration();
+        applyFreq();
+    }
+}
+
+void showMenu()
+{
+    DC_MenuStatus status;
+
+    if (g_config.menu == MENU_HIDDEN)
+        return;
+
+    PERF_BEGIN(PERF_DRAW_MENU);
+    status.freq[CLOCK_CPU] = scePowerGetArmClockFrequency();
+    status.freq[CLOCK_BUS] = scePowerGetBusClockFrequency();
+    status.freq[CLOCK_GPU] = scePowerGetGpuClockFrequency();
+    for (int i = 0; i < CLOCK_N; i++)
+        status.freq_config[i] = getFreq(i);
+    status.battery_low = g_battery_table < g_freq_table_n - 1;
+    status.battery_hot = g_battery_hot_table < g_freq_table_n - 1;
+    status.power = g_energy_power;
+    status.energy = g_energy;
+    status.frame_n = g_energy_frame_n;
+    status.transition_n = g_freq_transition_n;
+    drawMenu(&status);
+    PERF_END(PERF_DRAW_MENU);
 }
 
 int sceDisplaySetFrameBuf_patched(const SceDisplayFrameBuf *pParam, int sync)
 {
-    updateFramebuf(pParam);
+    PERF_BEGIN(PERF_FRAME);
+    applyMenu(updateMenu());
+
+    int freq_before[CLOCK_N];
+    DC_Audit audit;
+
+    // Idle decisions of watchdog thread, the audit ring has a single writer
+    int idle_pending = __sync_lock_test_and_set(&g_audit_idle_pending, 0);
+    for (int idle = IDLE_GAP; idle < IDLE_N; idle++) {
+        if (idle_pending & (1 << idle))
+            addAudit(&g_audit_idle[idle]);
+    }
+
+    // Battery ceilings moved, polled by watchdog thread
+    if (__sync_lock_test_and_set(&g_battery_changed, 0)) {
+        getAppliedFreq(freq_before);
+        updateFreqMax();
+        applyFreq();
+        initAudit(&audit, sceKernelGetProcessTimeLow(), REASON_BATTERY, freq_before);
+        addAudit(&audit);
+    }
+
+    int fb_changed = updateFramebuf(pParam);
     SceUInt32 tick_now = sceKernelGetProcessTimeLow();
+    int vcount_now = sceDisplayGetVcount();
 
     // Calculate target FPS and frametime
-    long frametime = tick_now - g_tick_last;
-    long real_frametime = tick_now - g_tick_real_last;
-
-    if (g_frametime_stable_n > FRAMETIME_STABLE_FRAMES_N) {
-        long frametime_avg = g_frametime_stable / g_frametime_stable_n;
-        g_fps_stable = (SECOND + frametime_avg - 1) / frametime_avg;
-        g_fps_target_stable = g_fps_stable > 35 ? 60 : 30;
-        g_frametime_target = SECOND / g_fps_target_stable;
-
-        g_frametime_stable_n = 0;
-        g_frametime_stable = 0;
-    } else {
-        g_frametime_stable += frametime;
-        g_frametime_stable_n++;
+    DC_PaceFrame pace;
+    measurePace(tick_now, vcount_now, sync == SCE_DISPLAY_SETBUF_IMMEDIATE, &pace);
+
+    // Single-buffered games present the same base every frame
+    if (fb_changed)
+        g_fb_change_n++;
+    if (++g_fb_flip_n >= FB_FLIP_WINDOW_N) {
+        g_fb_multi_buffered = g_fb_change_n > 0;
+        g_fb_flip_n = 0;
+        g_fb_change_n = 0;
     }
 
-    long frametime_trigger = g_frametime_target + g_drop_frametime_diff;
+    // Re-presented buffer or another flip within the same vblank, not a new frame
+    if ((g_fb_multi_buffered && !fb_changed) ||
+            (!pace.sync_immediate && pace.vblank_n == 0 && !g_idle && !g_resumed)) {
+        showMenu();
+        return TAI_CONTINUE(int, g_hook_ref[0], pParam, sync);
+    }
 
-    // Dynamic
-    if (g_mode[CLOCK_CPU] == MODE_DYNAMIC ||
-            g_mode[CLOCK_BUS] == MODE_DYNAMIC ||
-            g_mode[CLOCK_GPU] == MODE_DYNAMIC) {
+    if (tryLockFreq()) {
+        accumulateEnergy();
+        unlockFreq();
+    }
+    g_energy_frame_n++;
 
-        // Bump up
-        if (real_frametime >= frametime_trigger &&
-                g_frame_n_since_up > g_frame_n_cooldown_up) {
+    getAppliedFreq(freq_before);
+    if (updatePowerCap()) {
+        initAudit(&audit, tick_now, REASON_POWER_CAP, freq_before);
+        addAudit(&audit);
+    }
 
-            if (g_freq_current_table < FREQ_TABLE_N - 1)
-                g_freq_current_table++;
+    int reason = REASON_NONE;
+    int reason_governor = -1;
+    getAppliedFreq(freq_before);
+
+    // Resume from idle or suspend, loading entered or left
+    int pace_event = stepPace(&pace);
+    if (pace_event & PACE_RESET)
+        resetGovernor();
+    if (pace_event != PACE_NONE) {
+        applyFreq();
+        reason = pace_event & PACE_LOADING ? REASON_LOADING : REASON_RESUME;
+    }
 
-            g_frame_n_since_up = 0;
+    int dynamic = g_config.mode[CLOCK_CPU] == MODE_DYNAMIC ||
+                  g_config.mode[CLOCK_BUS] == MODE_DYNAMIC ||
+                  g_config.mode[CLOCK_GPU] == MODE_DYNAMIC;
+    int calibrating = isCalibrating();
+    updatePaceTarget(&pace, calibrating);
+
+    long frametime_trigger = g_frametime_target + g_drop_frametime_diff;
+
+    DC_Frame frame;
+    frame.frametime = pace.real_frametime;
+    frame.frametime_target = g_frametime_target;
+    frame.exact = g_uncapped || !g_frametime_vblank;
+    for (int i = 0; i < CLOCK_N; i++) {
+        frame.freq[i] = g_config.mode[i] == MODE_DYNAMIC ? getGovernorFreq(g_config.governor[i], i) : getFreq(i);
+        frame.freq_min[i] = g_freq_dynamic_min[i];
+        frame.freq_max[i] = g_freq_max[i];
+    }
+
+    frame.dropped = isPaceDropped(&pace, frametime_trigger);
+
+    // Calibration sweep, governors wait while clocks are perturbed
+    int search = isGovernorUsed(GOVERNOR_SEARCH);
+    if (dynamic && !g_loading && search && isCalibrating()) {
+        if (stepCalibration(&frame)) {
             applyFreq();
+            reason = REASON_CALIBRATION;
         }
-        // Bump down
-        else if (real_frametime < frametime_trigger &&
-                g_frame_n_since_up > g_frame_n_cooldown_down &&
-                g_frame_n_since_down > g_frame_n_cooldown_down) {
-
-            if (g_freq_current_table > 0)
-                g_freq_current_table--;
+    }
 
-            g_frame_n_since_down = 0;
+    // Dynamic, loading frames (first slow ones too) would only teach governors wrong
+    else if (dynamic && !g_loading && pace.frametime < g_loading_frametime) {
+        // Waiting for the sweep to start, governors keep running meanwhile
+        if (search && isCalibrationPending())
+            stepCalibration(&frame);
+
+        for (int gov = 0; gov < GOVERNOR_N; gov++) {
+            if (!isGovernorUsed(gov))
+                continue;
+
+            // Domains in other modes or driven by another governor are pinned
+            DC_Frame frame_gov = frame;
+            for (int i = 0; i < CLOCK_N; i++) {
+                if (g_config.mode[i] != MODE_DYNAMIC || g_config.governor[i] != gov) {
+                    frame_gov.freq_min[i] = frame.freq[i];
+                    frame_gov.freq_max[i] = frame.freq[i];
+                }
+            }
+            int gov_reason = g_governors[gov]->on_frame(&frame_gov);
+            if (gov_reason != REASON_NONE && reason_governor < 0) {
+                reason = gov_reason;
+                reason_governor = gov;
+            }
+        }
+        if (reason_governor >= 0)
             applyFreq();
+
+        g_profile_frame_n++;
+        for (int i = 0; i < CLOCK_N; i++) {
+            if (g_config.mode[i] == MODE_DYNAMIC)
+                g_profile_step_frame_n[i][getFreqStep(i, getGovernorFreq(g_config.governor[i], i))]++;
         }
     }
 
-    // Print shit on screen
-    if (g_menu == 1) {
-        drawStringF(0, 0, "%d/%d [%d|%d]",
-                    g_fps_stable,
-                    g_fps_target_stable,
-                    scePowerGetArmClockFrequency(),
-                    scePowerGetGpuClockFrequency());
-    } else if (g_menu == 2) {
-        char buf[5];
-
-        drawStringF(0, 0, "%d/%d [%d|%d|%d]",
-                    g_fps_stable,
-                    g_fps_target_stable,
-                    scePowerGetArmClockFrequency(),
-                    scePowerGetBusClockFrequency(),
-                    scePowerGetGpuClockFrequency());
-        drawStringF(0, 20, "               ");
-
-        sprintf(buf, "%d", getFreq(CLOCK_CPU));
-        setTextColor(COLOR_TEXT);
-        drawStringF(0, 40, "CPU:  ");
-        if (g_selected == CLOCK_CPU)
-            setTextColor(COLOR_TEXT_SELECT);
-        drawStringF(70, 40, "[%s]", (g_mode[CLOCK_CPU] == MODE_DYNAMIC ? "Dynamic" : (g_mode[CLOCK_CPU] == MODE_DEFAULT ? "Default" : buf)));
-
-        sprintf(buf, "%d", getFreq(CLOCK_BUS));
-        setTextColor(COLOR_TEXT);
-        drawStringF(0, 60, "BUS:  ");
-        if (g_selected == CLOCK_BUS)
-            setTextColor(COLOR_TEXT_SELECT);
-        drawStringF(70, 60, "[%s]", (g_mode[CLOCK_BUS] == MODE_DYNAMIC ? "Dynamic" : (g_mode[CLOCK_BUS] == MODE_DEFAULT ? "Default" : buf)));
-
-        sprintf(buf, "%d", getFreq(CLOCK_GPU));
-        setTextColor(COLOR_TEXT);
-        drawStringF(0, 80, "GPU:  ");
-        if (g_selected == CLOCK_GPU)
-            setTextColor(COLOR_TEXT_SELECT);
-        drawStringF(70, 80, "[%s]", (g_mode[CLOCK_GPU] == MODE_DYNAMIC ? "Dynamic" : (g_mode[CLOCK_GPU] == MODE_DEFAULT ? "Default" : buf)));
-
-        setTextColor(COLOR_TEXT);
+    // Pinned domains or ceiling moved without touching the clocks, nothing to explain
+    if (reason == REASON_RANGE && isAppliedFreq(freq_before))
+        reason = REASON_NONE;
+
+    // Remember why, justified bumps and noise look the same otherwise
+    if (reason != REASON_NONE) {
+        DC_GovernorAudit cooldown_none = {0, 0, 0, 0};
+        audit.tick = tick_now;
+        audit.reason = reason;
+        audit.governor = reason_governor;
+        audit.frametime = pace.real_frametime;
+        audit.frametime_target = g_frametime_target;
+        audit.frametime_trigger = frametime_trigger;
+        audit.vblank_n = pace.vblank_n;
+        audit.vblank_n_target = g_frametime_vblank && !g_uncapped ? VBLANK_RATE / g_fps_target_stable : 0;
+        if (reason_governor >= 0)
+            g_governors[reason_governor]->audit(&audit.cooldown);
+        else
+            audit.cooldown = cooldown_none;
+        for (int i = 0; i < CLOCK_N; i++) {
+            audit.freq_before[i] = freq_before[i];
+            audit.freq_after[i] = g_freq_applied[i];
+        }
+        addAudit(&audit);
     }
 
-    g_tick_last = tick_now;
-    g_tick_real_last = sceKernelGetProcessTimeLow();
-    g_frame_n_since_up++;
-    g_frame_n_since_down++;
+    PERF_END(PERF_FRAME);
+
+    // Print shit on screen
+    showMenu();
+
+    SceUInt32 tick_real_now = sceKernelGetProcessTimeLow();
+    endPace(tick_now, tick_real_now, vcount_now);
+
+#ifdef ENABLE_TRACE
+    DC_TraceRecord record;
+    SceUInt32 hook_time = tick_real_now - tick_now;
+    record.tick = tick_now;
+    record.frametime = pace.frametime;
+    record.hook_time = hook_time < 0xFFFF ? hook_time : 0xFFFF;
+    for (int i = 0; i < CLOCK_N; i++)
+        record.freq[i] = g_freq_applied[i];
+    record.flags = (frame.dropped ? TRACE_DROPPED : 0) |
+                   (g_loading ? TRACE_LOADING : 0) |
+                   (calibrating ? TRACE_CALIBRATING : 0) |
+                   (g_uncapped ? TRACE_UNCAPPED : 0);
+    record.reason = reason;
+    record.fps_target = g_fps_target_stable;
+    record.governor = reason_governor >= 0 ? reason_governor : 0xFF;
+    addTraceRecord(&record);
+#endif
 
     return TAI_CONTINUE(int, g_hook_ref[0], pParam, sync);
 }
 
+// Called by the game from any thread, and by writeFreq
 int scePowerSetArmClockFrequency_patched(int freq)
 {
-    return TAI_CONTINUE(int, g_hook_ref[1], getFreq(CLOCK_CPU));
+    DC_Config config;
+    readConfig(&config);
+    return TAI_CONTINUE(int, g_hook_ref[1], getConfigFreq(&config, CLOCK_CPU));
 }
 int scePowerSetBusClockFrequency_patched(int freq)
 {
-    return TAI_CONTINUE(int, g_hook_ref[2], getFreq(CLOCK_BUS));
+    DC_Config config;
+    readConfig(&config);
+    return TAI_CONTINUE(int, g_hook_ref[2], getConfigFreq(&config, CLOCK_BUS));
 }
 int scePowerSetGpuClockFrequency_patched(int freq)
 {
-    return TAI_CONTINUE(int, g_hook_ref[3], getFreq(CLOCK_GPU));
+    DC_Config config;
+    readConfig(&config);
+    return TAI_CONTINUE(int, g_hook_ref[3], getConfigFreq(&config, CLOCK_GPU));
 }
 
 int sceCtrlPeekBufferPositive_patched(int port, SceCtrlData *ctrl, int count)
@@ -322,10 +725,106 @@ int sceCtrlReadBufferPositive2_patched(int port, SceCtrlData *ctrl, int count)
     return ret;
 }
 
+int powerCallback(int notifyId, int notifyCount, int powerInfo, void *common)
+{
+    if (powerInfo & SCE_POWER_CB_RESUME_COMPLETE) {
+        SceUInt32 tick_now = sceKernelGetProcessTimeLow();
+        resumePace(tick_now);
+        g_energy_tick = tick_now; // nothing drawn while asleep
+
+        // Clocks are restored to system defaults on resume
+        applyFreq();
+    }
+
+    return 0;
+}
+
+int watchdogThread(SceSize args, void *argp)
+{
+    // Power callbacks are notified in this thread
+    SceUID cb_uid = sceKernelCreateCallback("DynClockPower", 0, powerCallback, NULL);
+    if (cb_uid >= 0)
+        scePowerRegisterCallback(cb_uid);
+
+    SceUInt32 tick_saved = sceKernelGetProcessTimeLow();
+    SceUInt32 tick_battery = tick_saved;
+    updateBatteryCeiling();
+
+    while (g_thread_run) {
+        SceUInt32 tick_now = sceKernelGetProcessTimeLow();
+
+        // Games are usually killed without module_stop, save as we go
+        if (tick_now - tick_saved >= PROFILE_SAVE_INTERVAL) {
+            saveTitleProfile();
+            saveTitleReport();
+#ifdef ENABLE_LOGGING
+            if (g_titleid[0] != '\0')
+                savePerf(g_titleid);
+#endif
+            tick_saved = tick_now;
+        }
+
+        if (g_audit_save) {
+            if (g_titleid[0] != '\0')
+                saveAudit(g_titleid);
+            g_audit_save = 0;
+        }
+
+#ifdef ENABLE_TRACE
+        // Frame recording, appended as it fills
+        if (g_titleid[0] != '\0')
+            flushTrace(g_titleid);
+#endif
+
+        // Battery changes slowly, no need to poll it every frame
+        if (tick_now - tick_battery >= BATTERY_INTERVAL) {
+            updateBatteryCeiling();
+            tick_battery = tick_now;
+        }
+
+        // No frames presented for a while, loading clocks first, lowest ones once it lasts
+        if (updatePaceIdle(tick_now)) {
+            int freq_before[CLOCK_N];
+            int idle = g_idle;
+
+            getAppliedFreq(freq_before);
+            applyFreq();
+            initAudit(&g_audit_idle[idle], tick_now, REASON_IDLE, freq_before);
+            __sync_fetch_and_or(&g_audit_idle_pending, 1 << idle);
+        }
+
+        sceKernelDelayThreadCB(WATCHDOG_INTERVAL);
+    }
+
+    if (cb_uid >= 0) {
+        scePowerUnregisterCallback(cb_uid);
+        sceKernelDeleteCallback(cb_uid);
+    }
+
+    return 0;
+}
+
 void _start() __attribute__ ((weak, alias ("module_start")));
 int module_start(SceSize argc, const void *args)
 {
-    g_tick_last = sceKernelGetProcessTimeLow();
+    buildFreqTable();
+    g_battery_table = g_freq_table_n - 1;
+    g_battery_hot_table = g_freq_table_n - 1;
+    resetPowerCap();
+
+    // Warm start from last session
+    if (sceAppMgrAppParamGetString(0, 12, g_titleid, sizeof(g_titleid)) != 0)
+        g_titleid[0] = '\0';
+    loadTitleProfile();
+
+    // Not calibrated in an earlier session yet
+    updateCalibration();
+
+    SceUInt32 tick_now = sceKernelGetProcessTimeLow();
+    startPace(tick_now, sceDisplayGetVcount());
+
+    g_energy_tick = tick_now;
+    applyFreq();
 
     g_hook[0] = taiHookFunctionImport(&g_hook_ref[0],
                                       TAI_MAIN_MODULE,
@@ -375,11 +874,35 @@ int module_start(SceSize argc, const void *args)
                                       0xC4226A3E,
                                       sceCtrlReadBufferPositive2_patched);
 
+    g_thread_run = 1;
+    g_thread_uid = sceKernelCreateThread("DynClockWatchdog", watchdogThread, 0x10000100, WATCHDOG_STACK_SIZE, 0, 0, NULL);
+    if (g_thread_uid >= 0)
+        sceKernelStartThread(g_thread_uid, 0, NULL);
+
     return SCE_KERNEL_START_SUCCESS;
 }
 
 int module_stop(SceSize argc, const void *args)
 {
+    g_thread_run = 0;
+    if (g_thread_uid >= 0) {
+        sceKernelWaitThreadEnd(g_thread_uid, NULL, NULL);
+        sceKernelDeleteThread(g_thread_uid);
+    }
+
+    saveTitleProfile();
+    saveTitleReport();
+    if (g_titleid[0] != '\0')
+        saveAudit(g_titleid);
+#ifdef ENABLE_LOGGING
+    if (g_titleid[0] != '\0')
+        savePerf(g_titleid);
+#endif
+#ifdef ENABLE_TRACE
+    if (g_titleid[0] != '\0')
+        flushTrace(g_titleid);
+#endif
+
     if (g_hook[0] >= 0)
         taiHookRelease(g_hook[0], g_hook_ref[0]);
     if (g_hook[1] >= 0)
@@ -397,10 +920,13 @@ int module_stop(SceSize argc, const void *args)
     if (g_hook[7] >= 0)
         taiHookRelease(g_hook[7], g_hook_ref[7]);
 
-    g_mode[CLOCK_CPU] = MODE_DEFAULT;
-    g_mode[CLOCK_BUS] = MODE_DEFAULT;
-    g_mode[CLOCK_GPU] = MODE_DEFAULT;
-    applyFreq();
+    // Hand back default clocks, g_config stays the display thread's. Lock is kept,
+    // a display hook still in flight leaves clocks alone.
+    while (!tryLockFreq())
+        sceKernelDelayThread(CONFIG_RETRY_DELAY);
+    scePowerSetArmClockFrequency(g_freq_default[CLOCK_CPU]);
+    scePowerSetBusClockFrequency(g_freq_default[CLOCK_BUS]);
+    scePowerSetGpuClockFrequency(g_freq_default[CLOCK_GPU]);
 
     return SCE_KERNEL_STOP_SUCCESS;
 }
@@ -0,0 +1,285 @@
+#include <psp2/types.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/display.h>
+#include <psp2/ctrl.h>
+#include <libk/stdio.h>
+#include "display.h"
+#include "freq.h"
+#include "governor.h"
+#include "audit.h"
+#include "pace.h"
+#include "menu.h"
+
+#define COLOR_TEXT_SELECT 0x004444FF
+#define COLOR_TEXT        0x00FFFFFF
+
+DC_Config g_config = {
+    {MODE_DYNAMIC, MODE_DYNAMIC, MODE_DYNAMIC},
+    {GOVERNOR_LADDER, GOVERNOR_LADDER, GOVERNOR_LADDER},
+    {0, 0, 0},
+    0,
+    0,
+    MENU_HIDDEN,
+    MENU_ITEM_CPU
+};
+static volatile uint32_t g_config_seq = 0; // odd while g_config is being written
+
+static int g_input_boost_analog_diff = 48; // minimal analog stick delta considered as fresh input
+
+static long g_buttons_old = 0;
+static unsigned char g_analog_old[4] = {128, 128, 128, 128}; // lx, ly, rx, ry
+static volatile unsigned long g_buttons_pressed        = 0; // new presses from input threads, handled by display thread
+static volatile unsigned long g_buttons_pressed_select = 0; // same, pressed while SELECT was held
+static volatile int g_input_fresh                      = 0; // fresh input seen, display thread boosts governors
+
+// Display thread only, every change to g_config goes between these two.
+// No applyFreq in between, the clock hooks read g_config through readConfig.
+void beginConfig()
+{
+    g_config_seq++;
+    __sync_synchronize();
+}
+
+void endConfig()
+{
+    __sync_synchronize();
+    g_config_seq++;
+}
+
+// Consistent copy of g_config from any thread, retries instead of locking out the display thread
+void readConfig(DC_Config *config)
+{
+    uint32_t seq;
+    do {
+        // Display thread preempted mid-write, spinning at higher priority would starve it
+        while ((seq = g_config_seq) & 1)
+            sceKernelDelayThread(CONFIG_RETRY_DELAY);
+        __sync_synchronize();
+        *config = g_config;
+        __sync_synchronize();
+    } while (seq != g_config_seq);
+}
+
+// Display thread, acts on presses recorded by checkButtons, DC_MenuEvent flags
+int updateMenu()
+{
+    unsigned long pressed_select = __sync_fetch_and_and(&g_buttons_pressed_select, 0);
+    unsigned long pressed = __sync_fetch_and_and(&g_buttons_pressed, 0);
+    int event = MENU_EVENT_NONE;
+
+    // Fresh input, boost clocks
+    if (__sync_lock_test_and_set(&g_input_fresh, 0)) {
+        for (int i = 0; i < GOVERNOR_N; i++)
+            g_governors[i]->on_input();
+    }
+
+    if (pressed == 0)
+        return event;
+
+    beginConfig();
+
+    // Toggle menu
+    if (pressed_select) {
+        if (g_config.menu < MENU_FULL && (pressed_select & SCE_CTRL_UP)) {
+            g_config.menu++;
+        }
+        else if (g_config.menu > MENU_HIDDEN && (pressed_select & SCE_CTRL_DOWN)) {
+            g_config.menu--;
+        }
+    }
+
+    // Full menu open
+    if (g_config.menu == MENU_FULL) {
+        // Move up/down in menu
+        if (g_config.selected > MENU_ITEM_CPU && (pressed & SCE_CTRL_UP))
+            g_config.selected--;
+        else if (g_config.selected < MENU_ITEM_N - 1 && (pressed & SCE_CTRL_DOWN))
+            g_config.selected++;
+
+        // Decision log, written by watchdog thread
+        if (pressed & SCE_CTRL_SQUARE)
+            event |= MENU_EVENT_AUDIT;
+
+        // Input boost
+        if (g_config.selected == MENU_ITEM_BOOST) {
+            if ((pressed & SCE_CTRL_RIGHT) && g_config.input_boost_frame_n < INPUT_BOOST_FRAME_N_MAX)
+                g_config.input_boost_frame_n += INPUT_BOOST_FRAME_N_STEP;
+            else if ((pressed & SCE_CTRL_LEFT) && g_config.input_boost_frame_n > 0)
+                g_config.input_boost_frame_n -= INPUT_BOOST_FRAME_N_STEP;
+        }
+        // Power cap
+        else if (g_config.selected == MENU_ITEM_POWER) {
+            if ((pressed & SCE_CTRL_RIGHT) && g_config.power_cap < POWER_CAP_MAX)
+                g_config.power_cap = g_config.power_cap == 0 ? POWER_CAP_MIN : g_config.power_cap + POWER_CAP_STEP;
+            else if ((pressed & SCE_CTRL_LEFT) && g_config.power_cap > 0)
+                g_config.power_cap = g_config.power_cap == POWER_CAP_MIN ? 0 : g_config.power_cap - POWER_CAP_STEP;
+
+            if (pressed & (SCE_CTRL_LEFT | SCE_CTRL_RIGHT))
+                event |= MENU_EVENT_POWER_CAP;
+        }
+        // Clocks
+        else {
+            if (pressed & SCE_CTRL_RIGHT) {
+                // Dynamic, next governor
+                if (g_config.mode[g_config.selected] == MODE_DYNAMIC && g_config.governor[g_config.selected] < GOVERNOR_N - 1) {
+                    g_config.governor[g_config.selected]++;
+                // Dynamic, Default
+                } else if (g_config.mode[g_config.selected] < MODE_MANUAL) {
+                    g_config.mode[g_config.selected]++;
+
+                    // Reset clocks
+                    if (g_config.mode[g_config.selected] == MODE_MANUAL)
+                        g_config.freq_current_step[g_config.selected] = getFreqStep(g_config.selected, g_freq_default[g_config.selected]);
+                // Manual
+                } else if (g_config.mode[g_config.selected] == MODE_MANUAL) {
+                    // Freq up
+                    if (g_config.freq_current_step[g_config.selected] < g_freq_step_n[g_config.selected] - 1)
+                        g_config.freq_current_step[g_config.selected]++;
+                }
+
+                event |= MENU_EVENT_APPLY;
+            }
+
+            if (pressed & SCE_CTRL_LEFT) {
+                // Dynamic, previous governor
+                if (g_config.mode[g_config.selected] == MODE_DYNAMIC && g_config.governor[g_config.selected] > 0)
+                    g_config.governor[g_config.selected]--;
+                // Default (1) -> Dynamic (0)
+                else if (g_config.mode[g_config.selected] == MODE_DEFAULT)
+                    g_config.mode[g_config.selected]--;
+                // Manual (2)
+                else if (g_config.mode[g_config.selected] == MODE_MANUAL) {
+                    // -> Default (1)
+                    if (g_config.freq_current_step[g_config.selected] == 0)
+                        g_config.mode[g_config.selected]--;
+                    // Freq down
+                    else if (g_config.freq_current_step[g_config.selected] > 0)
+                        g_config.freq_current_step[g_config.selected]--;
+                }
+
+                event |= MENU_EVENT_APPLY;
+            }
+        }
+    }
+
+    endConfig();
+    g_input_boost_frame_n = g_config.input_boost_frame_n;
+
+    return event;
+}
+
+// Input threads, only records presses, g_config is left to the display thread
+void checkButtons(SceCtrlData *ctrl)
+{
+    DC_Config config;
+    unsigned long pressed = ctrl->buttons & ~g_buttons_old;
+
+    if (pressed) {
+        __sync_fetch_and_or(&g_buttons_pressed, pressed);
+        if (ctrl->buttons & SCE_CTRL_SELECT)
+            __sync_fetch_and_or(&g_buttons_pressed_select, pressed);
+    }
+
+    // Fresh input (new presses or large analog movement), boost clocks
+    readConfig(&config);
+    if (config.input_boost_frame_n > 0 && config.menu != MENU_FULL && !(ctrl->buttons & SCE_CTRL_SELECT)) {
+        unsigned char analog[4] = {ctrl->lx, ctrl->ly, ctrl->rx, ctrl->ry};
+        int fresh = pressed != 0;
+
+        for (int i = 0; i < 4 && !fresh; i++) {
+            int diff = analog[i] - g_analog_old[i];
+            fresh = diff > g_input_boost_analog_diff || diff < -g_input_boost_analog_diff;
+        }
+
+        if (fresh)
+            g_input_fresh = 1;
+    }
+
+    g_analog_old[0] = ctrl->lx;
+    g_analog_old[1] = ctrl->ly;
+    g_analog_old[2] = ctrl->rx;
+    g_analog_old[3] = ctrl->ry;
+    g_buttons_old = ctrl->buttons;
+}
+
+void drawMenu(const DC_MenuStatus *status)
+{
+    if (g_config.menu == MENU_MINIMAL) {
+        drawStringF(0, 0, "%d/%d [%d|%d]",
+                    g_fps_stable,
+                    g_fps_target_stable,
+                    status->freq[CLOCK_CPU],
+                    status->freq[CLOCK_GPU]);
+    } else if (g_config.menu == MENU_FULL) {
+        char buf[5];
+
+        drawStringF(0, 0, "%d/%d [%d|%d|%d]",
+                    g_fps_stable,
+                    g_fps_target_stable,
+                    status->freq[CLOCK_CPU],
+                    status->freq[CLOCK_BUS],
+                    status->freq[CLOCK_GPU]);
+        if (g_loading)
+            drawStringF(0, 20, "Loading        ");
+        else if (status->battery_hot)
+            drawStringF(0, 20, "Battery hot    ");
+        else if (status->battery_low)
+            drawStringF(0, 20, "Battery low    ");
+        else
+            drawStringF(0, 20, g_uncapped ? "Uncapped       " : "               ");
+
+        sprintf(buf, "%d", status->freq_config[CLOCK_CPU]);
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 40, "CPU:  ");
+        if (g_config.selected == CLOCK_CPU)
+            setTextColor(COLOR_TEXT_SELECT);
+        drawStringF(70, 40, "[%s]", (g_config.mode[CLOCK_CPU] == MODE_DYNAMIC ? g_governors[g_config.governor[CLOCK_CPU]]->name : (g_config.mode[CLOCK_CPU] == MODE_DEFAULT ? "Default" : buf)));
+
+        sprintf(buf, "%d", status->freq_config[CLOCK_BUS]);
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 60, "BUS:  ");
+        if (g_config.selected == CLOCK_BUS)
+            setTextColor(COLOR_TEXT_SELECT);
+        drawStringF(70, 60, "[%s]", (g_config.mode[CLOCK_BUS] == MODE_DYNAMIC ? g_governors[g_config.governor[CLOCK_BUS]]->name : (g_config.mode[CLOCK_BUS] == MODE_DEFAULT ? "Default" : buf)));
+
+        sprintf(buf, "%d", status->freq_config[CLOCK_GPU]);
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 80, "GPU:  ");
+        if (g_config.selected == CLOCK_GPU)
+            setTextColor(COLOR_TEXT_SELECT);
+        drawStringF(70, 80, "[%s]", (g_config.mode[CLOCK_GPU] == MODE_DYNAMIC ? g_governors[g_config.governor[CLOCK_GPU]]->name : (g_config.mode[CLOCK_GPU] == MODE_DEFAULT ? "Default" : buf)));
+
+        sprintf(buf, "%ld", g_config.input_boost_frame_n);
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 100, "BOOST:");
+        if (g_config.selected == MENU_ITEM_BOOST)
+            setTextColor(COLOR_TEXT_SELECT);
+        drawStringF(70, 100, "[%s]   ", (g_config.input_boost_frame_n == 0 ? "Off" : buf));
+
+        sprintf(buf, "%d", g_config.power_cap);
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 120, "POWER:");
+        if (g_config.selected == MENU_ITEM_POWER)
+            setTextColor(COLOR_TEXT_SELECT);
+        drawStringF(70, 120, "[%s]   ", (g_config.power_cap == 0 ? "Off" : buf));
+
+        // Estimated, from g_power_step
+        long frame_uj = status->frame_n > 0 ? (long)(status->energy / status->frame_n) : 0;
+        setTextColor(COLOR_TEXT);
+        drawStringF(0, 140, "%d mW %ld.%ld mJ/f %ld J   ",
+                    status->power,
+                    frame_uj / 1000, frame_uj % 1000 / 100,
+                    (long)(status->energy / 1000000));
+        drawStringF(0, 160, "%ld changes %ld osc   ", status->transition_n, g_oscillation_n);
+
+        // Last decision, SQUARE saves the log
+        DC_Audit audit;
+        if (getAudit(0, &audit) == 0) {
+            drawStringF(0, 180, "%s %ld/%ldus %d|%d|%d>%d|%d|%d      ",
+                        g_reason_name[audit.reason], audit.frametime, audit.frametime_trigger,
+                        audit.freq_before[CLOCK_CPU], audit.freq_before[CLOCK_BUS], audit.freq_before[CLOCK_GPU],
+                        audit.freq_after[CLOCK_CPU], audit.freq_after[CLOCK_BUS], audit.freq_after[CLOCK_GPU]);
+        }
+    }
+}
+
@@ -0,0 +1,76 @@
+#ifndef _MENU_H_
+#define _MENU_H_
+
+#define CONFIG_RETRY_DELAY  100 // us, readConfig waits for a preempted writer this long
+
+#define INPUT_BOOST_FRAME_N_STEP 30
+#define INPUT_BOOST_FRAME_N_MAX  120
+
+#define POWER_CAP_MIN  300
+#define POWER_CAP_STEP 100
+#define POWER_CAP_MAX  1500
+
+typedef enum {
+	MODE_DYNAMIC = 0,
+	MODE_DEFAULT = 1,
+	MODE_MANUAL  = 2,
+	MODE_N       = 3
+} DC_Mode;
+
+typedef enum {
+	MENU_ITEM_CPU   = CLOCK_CPU,
+	MENU_ITEM_BUS   = CLOCK_BUS,
+	MENU_ITEM_GPU   = CLOCK_GPU,
+	MENU_ITEM_BOOST = 3,
+	MENU_ITEM_POWER = 4,
+	MENU_ITEM_N     = 5
+} DC_MenuItem;
+
+typedef enum {
+	MENU_HIDDEN  = 0,
+	MENU_MINIMAL = 1,
+	MENU_FULL    = 2,
+	MENU_N       = 3
+} DC_Menu;
+
+// What updateMenu changed, the display hook acts on them
+typedef enum {
+	MENU_EVENT_NONE      = 0,
+	MENU_EVENT_APPLY     = 1, // clock settings changed
+	MENU_EVENT_POWER_CAP = 2, // power cap changed, ceiling starts over
+	MENU_EVENT_AUDIT     = 4  // decision log requested
+} DC_MenuEvent;
+
+// Menu settings, written on the display thread only, other threads take a snapshot
+typedef struct {
+    int mode[CLOCK_N];              // DC_Mode (CPU, BUS, GPU)
+    int governor[CLOCK_N];          // g_governors index (Dynamic mode)
+    int freq_current_step[CLOCK_N]; // g_freq_step index (Manual mode)
+    long input_boost_frame_n;       // boost clocks for n frames after fresh input, 0 = off
+    int power_cap;                  // average power limit in Dynamic mode (mW), 0 = off
+    int menu;                       // DC_Menu
+    int selected;                   // DC_MenuItem
+} DC_Config;
+
+// Plugin state shown by drawMenu, gathered by the display hook
+typedef struct {
+    int freq[CLOCK_N];              // clocks read back from the power API (CPU, BUS, GPU)
+    int freq_config[CLOCK_N];       // clocks g_config asks for (CPU, BUS, GPU)
+    int battery_low;                // battery level ceiling in effect
+    int battery_hot;                // battery temperature ceiling in effect
+    int power;                      // estimated power draw of applied clocks (mW)
+    long long energy;               // estimated energy this session (uJ)
+    long frame_n;                   // num of presented frames this session
+    long transition_n;              // num of applied clock changes this session
+} DC_MenuStatus;
+
+extern DC_Config g_config;
+
+void beginConfig();
+void endConfig();
+void readConfig(DC_Config *config);
+int updateMenu();
+void checkButtons(SceCtrlData *ctrl);
+void drawMenu(const DC_MenuStatus *status);
+
+#endif
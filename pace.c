@@ -0,0 +1,175 @@
+#include <stdint.h>
+#include "freq.h"
+#include "governor.h"
+#include "pace.h"
+
+long g_frametime_target           = 33333;
+int g_fps_stable                  = 30;
+int g_fps_target_stable           = 30;
+int g_uncapped                    = 0; // game flips without waiting for vsync
+
+int g_frametime_vblank            = 1;               // detect drops by vblanks missed instead of process time
+int g_fps_target_uncapped         = 30;              // target FPS for games not synced to vblank
+long g_loading_frametime          = SECOND * 0.200f; // 200ms - minimal frametime considered as loading
+long g_loading_frame_n_enter      = 2;               // n of consecutive slow frames to enter loading phase
+long g_loading_frame_n_exit       = 30;              // n of consecutive normal frames to leave loading phase
+long g_idle_frametime             = SECOND * 2;      // 2s - no frame presented for this long races it like loading
+long g_idle_frametime_deep        = SECOND * 30;     // 30s - no frame presented for this long drops to lowest clocks
+
+int g_loading                     = 0; // in loading phase (Dynamic mode)
+// Set from the watchdog thread and the power callback
+volatile int g_idle               = 0; // DC_Idle, game stopped presenting frames (Dynamic mode)
+volatile int g_resumed            = 0; // console resumed from suspend, governor reset pending
+
+static long g_frametime_stable       = 33333;
+static int g_frametime_stable_n      = 0;
+static int g_sync_immediate_n        = 0; // num of immediate flips in current stable window
+static long g_loading_frame_n_slow   = 0; // num of consecutive loading frames
+static long g_loading_frame_n_normal = 0; // num of consecutive normal frames while loading
+
+static volatile uint32_t g_tick_last = 1; // tick of last frame
+static uint32_t g_tick_real_last     = 1; // real tick of last frame (ignore costs of calling sceXXXXX)
+static int g_vcount_last             = 0; // vblank count at last frame
+
+static void resetPaceWindow()
+{
+    g_frametime_stable   = 0;
+    g_frametime_stable_n = 0;
+    g_sync_immediate_n   = 0;
+}
+
+void measurePace(uint32_t tick_now, int vcount_now, int sync_immediate, DC_PaceFrame *pace)
+{
+    pace->tick = tick_now;
+    pace->frametime = tick_now - g_tick_last;
+    pace->real_frametime = tick_now - g_tick_real_last;
+    pace->vblank_n = vcount_now - g_vcount_last;
+    pace->sync_immediate = sync_immediate;
+}
+
+// DC_PaceEvent flags, a new frame was presented
+int stepPace(DC_PaceFrame *pace)
+{
+    int event = PACE_NONE;
+
+    // Back from idle or suspend, don't treat the gap as a frame
+    if (g_idle || g_resumed) {
+        // The watchdog must not measure the gap again before endPace
+        g_tick_last = pace->tick;
+        __sync_synchronize();
+        g_idle = 0;
+        g_resumed = 0;
+        g_loading = 0;
+        pace->frametime = g_frametime_target;
+        pace->real_frametime = g_frametime_target;
+        pace->vblank_n = VBLANK_RATE / g_fps_target_stable;
+        event |= PACE_RESUME | PACE_RESET;
+    }
+
+    // Loading screen detection
+    if (pace->frametime >= g_loading_frametime) {
+        g_loading_frame_n_normal = 0;
+
+        // Race to idle, CPU up, GPU down
+        if (!g_loading && ++g_loading_frame_n_slow >= g_loading_frame_n_enter) {
+            g_loading = 1;
+            event |= PACE_LOADING;
+        }
+    } else {
+        g_loading_frame_n_slow = 0;
+
+        // Normal frame cadence resumed, start over
+        if (g_loading && ++g_loading_frame_n_normal >= g_loading_frame_n_exit) {
+            g_loading = 0;
+            event |= PACE_LOADING | PACE_RESET;
+        }
+    }
+
+    if (event & PACE_RESET)
+        resetPaceWindow();
+
+    return event;
+}
+
+// Target FPS from the average of stable windows
+void updatePaceTarget(const DC_PaceFrame *pace, int calibrating)
+{
+    if (g_loading || calibrating) {
+        // Don't pollute averages with loading frames or perturbed clocks
+    } else if (g_frametime_stable_n > FRAMETIME_STABLE_FRAMES_N) {
+        long frametime_avg = g_frametime_stable / g_frametime_stable_n;
+        g_fps_stable = (SECOND + frametime_avg - 1) / frametime_avg;
+
+        // Mostly immediate flips, vsync rule doesn't apply
+        g_uncapped = g_sync_immediate_n * 2 > g_frametime_stable_n;
+        if (g_uncapped)
+            g_fps_target_stable = g_fps_target_uncapped;
+        else
+            g_fps_target_stable = g_fps_stable > 35 ? 60 : 30;
+        g_frametime_target = SECOND / g_fps_target_stable;
+
+        resetPaceWindow();
+    } else {
+        g_frametime_stable += pace->frametime;
+        g_frametime_stable_n++;
+        if (pace->sync_immediate)
+            g_sync_immediate_n++;
+    }
+}
+
+// Frame missed its vsync (exact) or took longer than target (timer based)
+int isPaceDropped(const DC_PaceFrame *pace, long frametime_trigger)
+{
+    if (g_frametime_vblank && !g_uncapped)
+        return pace->vblank_n > VBLANK_RATE / g_fps_target_stable;
+    return pace->real_frametime >= frametime_trigger;
+}
+
+// Fresh session, nothing measured yet
+void startPace(uint32_t tick_now, int vcount_now)
+{
+    g_frametime_target = 33333;
+    g_fps_stable = 30;
+    g_fps_target_stable = 30;
+    g_uncapped = 0;
+    g_idle = 0;
+    g_resumed = 0;
+    g_loading = 0;
+    g_frametime_stable = 33333;
+    g_frametime_stable_n = 0;
+    g_sync_immediate_n = 0;
+    g_loading_frame_n_slow = 0;
+    g_loading_frame_n_normal = 0;
+    endPace(tick_now, tick_now, vcount_now);
+}
+
+void endPace(uint32_t tick_now, uint32_t tick_real_now, int vcount_now)
+{
+    g_tick_last = tick_now;
+    g_tick_real_last = tick_real_now;
+    g_vcount_last = vcount_now;
+}
+
+// Nothing drawn while asleep, next frame is not measured from before suspend
+void resumePace(uint32_t tick_now)
+{
+    g_tick_last = tick_now;
+    g_tick_real_last = tick_now;
+    g_resumed = 1;
+}
+
+// Watchdog thread, 1 when no frames were presented long enough to enter a deeper idle stage
+int updatePaceIdle(uint32_t tick_now)
+{
+    // Stage read before the tick, a frame clearing it in between makes the swap fail
+    int idle_last = g_idle;
+    __sync_synchronize();
+
+    long gap = (long)(tick_now - g_tick_last);
+    int idle = gap >= g_idle_frametime_deep ? IDLE_DEEP :
+               gap >= g_idle_frametime ? IDLE_GAP : IDLE_OFF;
+    if (g_resumed || idle <= idle_last)
+        return 0;
+
+    return __sync_bool_compare_and_swap(&g_idle, idle_last, idle);
+}
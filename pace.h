@@ -0,0 +1,57 @@
+#ifndef _PACE_H_
+#define _PACE_H_
+
+#define FRAMETIME_STABLE_FRAMES_N 5
+#define VBLANK_RATE         60
+
+typedef enum {
+	IDLE_OFF  = 0,
+	IDLE_GAP  = 1, // no frames for a while, most likely loading without drawing
+	IDLE_DEEP = 2, // no frames for much longer, nothing left to race through
+	IDLE_N    = 3
+} DC_Idle;
+
+// What stepPace changed, the hook reapplies clocks for any of them
+typedef enum {
+	PACE_NONE    = 0,
+	PACE_RESUME  = 1, // back from idle or suspend, the gap was not a frame
+	PACE_LOADING = 2, // loading phase entered or left
+	PACE_RESET   = 4  // governors must start over
+} DC_PaceEvent;
+
+// Presented frame as measured by the display hook
+typedef struct {
+    uint32_t tick;          // process time the frame was presented at
+    long frametime;         // since last frame
+    long real_frametime;    // since last frame (ignore costs of calling sceXXXXX)
+    int vblank_n;           // vblanks since last frame
+    int sync_immediate;     // flipped without waiting for vsync
+} DC_PaceFrame;
+
+extern long g_frametime_target;
+extern int g_fps_stable;
+extern int g_fps_target_stable;
+extern int g_uncapped;
+
+extern int g_frametime_vblank;
+extern int g_fps_target_uncapped;
+extern long g_loading_frametime;
+extern long g_loading_frame_n_enter;
+extern long g_loading_frame_n_exit;
+extern long g_idle_frametime;
+extern long g_idle_frametime_deep;
+
+extern volatile int g_idle;
+extern volatile int g_resumed;
+extern int g_loading;
+
+void measurePace(uint32_t tick_now, int vcount_now, int sync_immediate, DC_PaceFrame *pace);
+int stepPace(DC_PaceFrame *pace);
+void updatePaceTarget(const DC_PaceFrame *pace, int calibrating);
+int isPaceDropped(const DC_PaceFrame *pace, long frametime_trigger);
+void startPace(uint32_t tick_now, int vcount_now);
+void endPace(uint32_t tick_now, uint32_t tick_real_now, int vcount_now);
+void resumePace(uint32_t tick_now);
+int updatePaceIdle(uint32_t tick_now);
+
+#endif
@@ -0,0 +1,70 @@
+#include <psp2/types.h>
+#include <libk/stdio.h>
+#include "datafile.h"
+#include "perf.h"
+
+#define PERF_BUCKET_N 64 // 1us buckets, last one collects the rest
+
+typedef struct {
+    long n;
+    long long sum;                  // us
+    uint32_t min;                   // us
+    uint32_t max;                   // us
+    long bucket[PERF_BUCKET_N];     // num of samples per us
+} DC_PerfStats;
+
+static const char *g_perf_name[PERF_N] = {"frame", "drawMenu"};
+static DC_PerfStats g_perf[PERF_N];
+
+void addPerfSample(int section, uint32_t us)
+{
+    DC_PerfStats *stats = &g_perf[section];
+
+    if (stats->n == 0 || us < stats->min)
+        stats->min = us;
+    if (us > stats->max)
+        stats->max = us;
+
+    stats->n++;
+    stats->sum += us;
+    stats->bucket[us < PERF_BUCKET_N ? us : PERF_BUCKET_N - 1]++;
+}
+
+// Smallest us at least percent of samples fit in
+static int getPerfPercentile(const DC_PerfStats *stats, int percent)
+{
+    long n = 0;
+    for (int us = 0; us < PERF_BUCKET_N; us++) {
+        n += stats->bucket[us];
+        if (n * 100 >= stats->n * percent)
+            return us;
+    }
+    return PERF_BUCKET_N - 1;
+}
+
+// JSON, one object per section, ns/op averaged over all samples
+int savePerf(const char *titleid)
+{
+    char buf[1024];
+    int size = sizeof(buf);
+    int len = 0;
+
+    len += snprintf(buf + len, size - len, "{\"title\":\"%s\",\"sections\":[", titleid);
+    for (int i = 0; i < PERF_N; i++) {
+        const DC_PerfStats *stats = &g_perf[i];
+        long ns = stats->n > 0 ? (long)(stats->sum * 1000 / stats->n) : 0;
+
+        len += snprintf(buf + len, size - len,
+                        "%s{\"name\":\"%s\",\"n\":%ld,\"ns_per_op\":%ld,"
+                        "\"min_us\":%lu,\"p50_us\":%d,\"p99_us\":%d,\"max_us\":%lu}",
+                        i > 0 ? "," : "", g_perf_name[i], stats->n, ns,
+                        (unsigned long)stats->min, getPerfPercentile(stats, 50),
+                        getPerfPercentile(stats, 99), (unsigned long)stats->max);
+    }
+    len += snprintf(buf + len, size - len, "]}\n");
+
+    if (len > size - 1)
+        len = size - 1;
+
+    return writeDataFile(titleid, "_perf.json", buf, len);
+}
@@ -0,0 +1,23 @@
+#ifndef _PERF_H_
+#define _PERF_H_
+
+typedef enum {
+	PERF_FRAME         = 0, // sceDisplaySetFrameBuf_patched, governed frame without overlay
+	PERF_DRAW_MENU     = 1, // showMenu, menu visible
+	PERF_N             = 2
+} DC_PerfSection;
+
+// Hook timing, debug builds only. Process time ticks in us, so sections
+// shorter than that, like checkButtons, are timed by tools/bench.c instead.
+#ifdef ENABLE_LOGGING
+#define PERF_BEGIN(section) SceUInt32 perf_tick_##section = sceKernelGetProcessTimeLow()
+#define PERF_END(section)   addPerfSample(section, sceKernelGetProcessTimeLow() - perf_tick_##section)
+#else
+#define PERF_BEGIN(section)
+#define PERF_END(section)
+#endif
+
+void addPerfSample(int section, uint32_t us);
+int savePerf(const char *titleid);
+
+#endif
@@ -0,0 +1,23 @@
+#include <psp2/types.h>
+#include "datafile.h"
+#include "profile.h"
+
+int loadProfile(const char *titleid, DC_Profile *profile)
+{
+    int ret = readDataFile(titleid, ".bin", profile, sizeof(DC_Profile));
+    if (ret < 0)
+        return ret;
+
+    // Missing, truncated or from an older version
+    if (ret != sizeof(DC_Profile) ||
+            profile->magic != PROFILE_MAGIC ||
+            profile->version != PROFILE_VERSION)
+        return -1;
+
+    return 0;
+}
+
+int saveProfile(const char *titleid, const DC_Profile *profile)
+{
+    return writeDataFile(titleid, ".bin", profile, sizeof(DC_Profile));
+}
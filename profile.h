@@ -0,0 +1,32 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#define PROFILE_MAGIC   0x4B4C4344 // DCLK
+#define PROFILE_VERSION 4
+#define PROFILE_CLOCK_N 3
+
+// Battery settings until a profile changes them, shared with tools/tune.c
+#define PROFILE_BATTERY_LOW_PERCENT      20
+#define PROFILE_BATTERY_CRITICAL_PERCENT 10
+#define PROFILE_BATTERY_HOT_TEMP         45
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int freq[PROFILE_CLOCK_N];            // typical dynamic clocks (CPU, BUS, GPU)
+    int governor[PROFILE_CLOCK_N];        // g_governors index (CPU, BUS, GPU), -1 = unset
+    int fps_target;                       // observed target FPS
+    int calibration_cpu_share;            // calibrated CPU share (%), -1 = unknown
+    float sensitivity[PROFILE_CLOCK_N];   // learned sensitivity model
+    int battery_low_percent;              // battery % capping clocks at g_freq_battery_low
+    int battery_critical_percent;         // battery % capping clocks at g_freq_battery_critical
+    int battery_hot_temp;                 // battery temperature (C) stepping the ceiling down
+    int drop_frametime_diff;              // governor tuning (us), 0 = built-in default
+    int frame_n_cooldown_up;              // governor tuning, 0 = built-in default
+    int frame_n_cooldown_down;            // governor tuning, 0 = built-in default
+} DC_Profile;
+
+int loadProfile(const char *titleid, DC_Profile *profile);
+int saveProfile(const char *titleid, const DC_Profile *profile);
+
+#endif
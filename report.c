@@ -0,0 +1,49 @@
+#include <psp2/types.h>
+#include <libk/stdio.h>
+#include "freq.h"
+#include "datafile.h"
+#include "report.h"
+
+static const char *g_report_clock_name[CLOCK_N] = {"CPU", "BUS", "GPU"};
+
+// Plain text, readable without any tools
+int saveReport(const char *titleid, const DC_Report *report)
+{
+    char buf[1024];
+    int size = sizeof(buf);
+    int len = 0;
+
+    long duration_s = (long)(report->duration / 1000000);
+    long energy_mj = (long)(report->energy / 1000);
+    long power_mw = report->duration > 0 ? (long)(report->energy * 1000 / report->duration) : 0;
+    long frame_uj = report->frame_n > 0 ? (long)(report->energy / report->frame_n) : 0;
+
+    len += snprintf(buf + len, size - len,
+                    "Title:            %s\n"
+                    "Duration:         %ld s\n"
+                    "Frames:           %ld\n"
+                    "Target FPS:       %d\n"
+                    "Energy:           %ld mJ\n"
+                    "Average power:    %ld mW\n"
+                    "Energy per frame: %ld.%ld mJ\n"
+                    "Clock changes:    %ld\n"
+                    "Oscillations:     %ld\n",
+                    titleid, duration_s, report->frame_n, report->fps_target,
+                    energy_mj, power_mw, frame_uj / 1000, frame_uj % 1000 / 100,
+                    report->transition_n, report->oscillation_n);
+
+    // Governed frames per clock
+    for (int i = 0; i < CLOCK_N; i++) {
+        len += snprintf(buf + len, size - len, "%s frames:      ", g_report_clock_name[i]);
+        for (int step = 0; step < g_freq_step_n[i]; step++) {
+            len += snprintf(buf + len, size - len, " %d:%ld",
+                            g_freq_step[i][step], report->step_frame_n[i][step]);
+        }
+        len += snprintf(buf + len, size - len, "\n");
+    }
+
+    if (len > size - 1)
+        len = size - 1;
+
+    return writeDataFile(titleid, ".txt", buf, len);
+}
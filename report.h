@@ -0,0 +1,16 @@
+#ifndef _REPORT_H_
+#define _REPORT_H_
+
+typedef struct {
+    long long duration;                         // session time (us)
+    long long energy;                           // estimated energy (uJ)
+    long frame_n;                               // num of presented frames
+    int fps_target;                             // observed target FPS
+    long transition_n;                          // num of applied clock changes
+    long oscillation_n;                         // num of bump downs undone shortly after
+    long step_frame_n[CLOCK_N][FREQ_STEP_MAX];  // governed frames per g_freq_step index
+} DC_Report;
+
+int saveReport(const char *titleid, const DC_Report *report);
+
+#endif
@@ -0,0 +1,371 @@
+// Host microbenchmarks of the overlay, input and governor hot paths
+//
+//   cc -O2 -std=gnu99 -I.. -Ihost -o bench bench.c ../menu.c ../audit.c ../datafile.c ../display.c ../pace.c ../freq.c ../governor.c
+//   ./bench [-r run_n] [-o out.json] [-c baseline.json] [-t percent]
+//
+// host/ stands in for the few VitaSDK headers the plugin sources include.
+// Every benchmark is warmed up, then timed run_n times over batches of
+// ~20 ms; ns/op is the median run, min and max show the spread. -c compares
+// the fastest runs, least disturbed by the rest of the machine, with an
+// earlier output and exits 1 when any got more than percent slower (default
+// 10). hook_frame chains the calls sceDisplaySetFrameBuf_patched makes for a
+// governed frame with the overlay hidden, minus the SCE calls.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <psp2/display.h>
+#include <psp2/ctrl.h>
+
+#include "display.h"
+#include "freq.h"
+#include "governor.h"
+#include "audit.h"
+#include "pace.h"
+#include "menu.h"
+
+#define FB_WIDTH            960
+#define FB_HEIGHT           544
+#define RUN_MAX             64
+#define RUN_NS              20000000 // batch length to time, 20 ms
+#define FRAME_N             256      // distinct frames fed to governors, cycled
+#define BENCH_MAX           16
+
+typedef struct {
+    const char *name;
+    void (*run)(long n);
+} DC_Bench;
+
+typedef struct {
+    char name[32];
+    long op_n;              // ops per run
+    double ns;              // median ns/op
+    double ns_min;
+    double ns_max;
+} DC_BenchResult;
+
+static uint32_t g_fb[FB_WIDTH * FB_HEIGHT];
+static DC_Frame g_frames[FRAME_N];
+static volatile long g_sink;    // keeps results alive
+
+static long long getTimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void benchDrawCharacter(long n)
+{
+    for (long i = 0; i < n; i++)
+        drawCharacter('0' + (i & 63), (i & 31) * 12, (i >> 5 & 15) * 20);
+}
+
+static void benchDrawString(long n)
+{
+    for (long i = 0; i < n; i++)
+        drawString(0, (i & 15) * 20, "60/60 [444|222|222]");
+}
+
+static void benchDrawStringF(long n)
+{
+    for (long i = 0; i < n; i++)
+        drawStringF(0, (i & 15) * 20, "%d/%d [%d|%d|%d]", 59, 60, 444, 222, (int)(i & 255));
+}
+
+// Full menu, status as the hook would gather it
+static void benchMenu(long n)
+{
+    DC_MenuStatus status = {{444, 222, 222}, {444, 222, 222}, 0, 0, 1234, 20000000LL, 1000, 321};
+
+    g_config.menu = MENU_FULL;
+    for (long i = 0; i < n; i++)
+        drawMenu(&status);
+    g_config.menu = MENU_HIDDEN;
+}
+
+// Input hook, presses and stick movement every other call
+static void benchCheckButtons(long n)
+{
+    SceCtrlData ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+
+    g_config.input_boost_frame_n = INPUT_BOOST_FRAME_N_STEP;
+    for (long i = 0; i < n; i++) {
+        ctrl.buttons = i & 1 ? SCE_CTRL_CROSS : 0;
+        ctrl.lx = i & 2 ? 0 : 255;
+        checkButtons(&ctrl);
+    }
+    g_sink += updateMenu();
+    g_config.input_boost_frame_n = 0;
+}
+
+// One governed frame: requested clocks read back, then on_frame
+static void benchGovernor(int governor, long n)
+{
+    DC_GovernorState state;
+    long changed_n = 0;
+
+    // Same decisions every run
+    g_governors[governor]->init(NULL);
+    for (long i = 0; i < n; i++) {
+        DC_Frame frame = g_frames[i % FRAME_N];
+        g_governors[governor]->snapshot(&state);
+        for (int c = 0; c < CLOCK_N; c++)
+            frame.freq[c] = state.freq[c];
+        changed_n += g_governors[governor]->on_frame(&frame) != REASON_NONE;
+    }
+    g_sink += changed_n;
+}
+
+static void benchLadder(long n)
+{
+    benchGovernor(GOVERNOR_LADDER, n);
+}
+
+static void benchSearch(long n)
+{
+    benchGovernor(GOVERNOR_SEARCH, n);
+}
+
+// Frame pacing of the display hook, 60 FPS with an occasional missed vblank
+static void benchPace(long n)
+{
+    static uint32_t tick = 0;
+    static int vcount = 0;
+    DC_PaceFrame pace;
+    long dropped_n = 0;
+
+    for (long i = 0; i < n; i++) {
+        int vblank_n = (i & 31) == 31 ? 2 : 1;
+        tick += vblank_n * 16667;
+        vcount += vblank_n;
+
+        measurePace(tick, vcount, 0, &pace);
+        stepPace(&pace);
+        updatePaceTarget(&pace, 0);
+        dropped_n += isPaceDropped(&pace, g_frametime_target + g_drop_frametime_diff);
+        endPace(tick, tick, vcount);
+    }
+    g_sink += dropped_n;
+}
+
+// Governed frame of the display hook, overlay hidden
+static void benchHookFrame(long n)
+{
+    static uint32_t tick = 0;
+    static int vcount = 0;
+    DC_GovernorState state;
+    DC_PaceFrame pace;
+    DC_Frame frame;
+    long changed_n = 0;
+
+    g_governors[GOVERNOR_LADDER]->init(NULL);
+    for (long i = 0; i < n; i++) {
+        int vblank_n = (i & 31) == 31 ? 2 : 1;
+        tick += vblank_n * 16667;
+        vcount += vblank_n;
+
+        changed_n += updateMenu();
+        measurePace(tick, vcount, 0, &pace);
+        if (stepPace(&pace) & PACE_RESET)
+            g_governors[GOVERNOR_LADDER]->on_suspend();
+        updatePaceTarget(&pace, 0);
+
+        g_governors[GOVERNOR_LADDER]->snapshot(&state);
+        frame.frametime = pace.real_frametime;
+        frame.frametime_target = g_frametime_target;
+        frame.exact = 0;
+        frame.dropped = isPaceDropped(&pace, g_frametime_target + g_drop_frametime_diff);
+        for (int c = 0; c < CLOCK_N; c++) {
+            frame.freq[c] = state.freq[c];
+            frame.freq_min[c] = g_freq_dynamic_min[c];
+            frame.freq_max[c] = g_freq_step[c][g_freq_step_n[c] - 1];
+        }
+        if (!g_loading && pace.frametime < g_loading_frametime)
+            changed_n += g_governors[GOVERNOR_LADDER]->on_frame(&frame) != REASON_NONE;
+
+        endPace(tick, tick, vcount);
+    }
+    g_sink += changed_n;
+}
+
+static const DC_Bench g_benches[] = {
+    {"drawCharacter",   benchDrawCharacter},
+    {"drawString",      benchDrawString},
+    {"drawStringF",     benchDrawStringF},
+    {"drawMenu",        benchMenu},
+    {"ladder_on_frame", benchLadder},
+    {"search_on_frame", benchSearch},
+    {"pace_frame",      benchPace},
+    {"checkButtons",    benchCheckButtons},
+    {"hook_frame",      benchHookFrame},
+};
+static const int g_bench_n = sizeof(g_benches) / sizeof(g_benches[0]);
+
+// Governors see frames around a 60 FPS target, some over it
+static void buildFrames()
+{
+    unsigned int seed = 1;
+
+    for (int i = 0; i < FRAME_N; i++) {
+        DC_Frame *frame = &g_frames[i];
+        seed = seed * 1103515245 + 12345;
+
+        frame->frametime_target = SECOND / 60;
+        frame->frametime = frame->frametime_target * (80 + (seed >> 16) % 40) / 100;
+        frame->dropped = frame->frametime >= frame->frametime_target + g_drop_frametime_diff;
+        frame->exact = 1;
+        for (int c = 0; c < CLOCK_N; c++) {
+            frame->freq_min[c] = g_freq_dynamic_min[c];
+            frame->freq_max[c] = g_freq_step[c][g_freq_step_n[c] - 1];
+        }
+    }
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void runBench(const DC_Bench *bench, int run_n, DC_BenchResult *result)
+{
+    double ns[RUN_MAX];
+    long op_n = 1;
+
+    // Grow the batch until it takes long enough to time, doubles as warm-up
+    for (;;) {
+        long long begin = getTimeNs();
+        bench->run(op_n);
+        if (getTimeNs() - begin >= RUN_NS)
+            break;
+        op_n *= 2;
+    }
+
+    for (int r = 0; r < run_n; r++) {
+        long long begin = getTimeNs();
+        bench->run(op_n);
+        ns[r] = (double)(getTimeNs() - begin) / op_n;
+    }
+    qsort(ns, run_n, sizeof(ns[0]), compareDouble);
+
+    snprintf(result->name, sizeof(result->name), "%s", bench->name);
+    result->op_n = op_n;
+    result->ns = run_n % 2 ? ns[run_n / 2] : (ns[run_n / 2 - 1] + ns[run_n / 2]) / 2;
+    result->ns_min = ns[0];
+    result->ns_max = ns[run_n - 1];
+}
+
+static void printResults(FILE *out, const DC_BenchResult *result, int run_n)
+{
+    fprintf(out, "{\"runs\":%d,\"benchmarks\":[\n", run_n);
+    for (int i = 0; i < g_bench_n; i++) {
+        fprintf(out, "{\"name\":\"%s\",\"ops_per_run\":%ld,\"ns_per_op\":%.2f,\"min_ns\":%.2f,\"max_ns\":%.2f}%s\n",
+                result[i].name, result[i].op_n, result[i].ns, result[i].ns_min, result[i].ns_max,
+                i < g_bench_n - 1 ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+// Num of benchmarks slower than baseline by more than percent, -1 on error
+static int compareBaseline(const char *path, const DC_BenchResult *result, double percent)
+{
+    char line[256];
+    int slower_n = 0;
+
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        char name[32];
+        double ns;
+        if (sscanf(line, "{\"name\":\"%31[^\"]\",\"ops_per_run\":%*d,\"ns_per_op\":%*f,\"min_ns\":%lf",
+                   name, &ns) != 2)
+            continue;
+
+        for (int i = 0; i < g_bench_n; i++) {
+            if (strcmp(result[i].name, name) || ns <= 0)
+                continue;
+            double diff = (result[i].ns_min - ns) * 100 / ns;
+            int slower = diff > percent;
+            fprintf(stderr, "%-16s %10.2f -> %10.2f ns/op %+6.1f%%%s\n",
+                    name, ns, result[i].ns_min, diff, slower ? "  SLOWER" : "");
+            slower_n += slower;
+        }
+    }
+
+    fclose(in);
+    return slower_n;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: bench [-r run_n] [-o out.json] [-c baseline.json] [-t percent]\n");
+}
+
+int main(int argc, char **argv)
+{
+    DC_BenchResult result[BENCH_MAX];
+    const char *out_path = NULL;
+    const char *baseline = NULL;
+    double percent = 10;
+    int run_n = 15;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            run_n = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            percent = atof(argv[++i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (run_n < 1 || run_n > RUN_MAX) {
+        usage();
+        return 1;
+    }
+
+    buildFreqTable();
+    buildFrames();
+    g_calibration_cpu_share = -1;
+    g_governors[GOVERNOR_LADDER]->init(NULL);
+    g_governors[GOVERNOR_SEARCH]->init(NULL);
+
+    SceDisplayFrameBuf param = {sizeof(param), g_fb, FB_WIDTH, 0, FB_WIDTH, FB_HEIGHT};
+    updateFramebuf(&param);
+
+    // Last decision line of the full menu
+    DC_Audit audit = {0, REASON_DROP, GOVERNOR_LADDER, 35000, 33333, 34333, 2, 2, {0, 0, 0, 0},
+                      {333, 222, 166}, {444, 222, 222}};
+    addAudit(&audit);
+
+    for (int i = 0; i < g_bench_n; i++)
+        runBench(&g_benches[i], run_n, &result[i]);
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+    printResults(out, result, run_n);
+    if (out != stdout)
+        fclose(out);
+
+    if (baseline) {
+        int slower_n = compareBaseline(baseline, result, percent);
+        if (slower_n != 0)
+            return 1;
+    }
+
+    return 0;
+}
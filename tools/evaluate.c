@@ -0,0 +1,162 @@
+// Evaluate every governor over many sessions on all cores
+//
+//   cc -O2 -std=gnu99 -I.. -o evaluate evaluate.c workload.c ../pace.c ../freq.c ../governor.c
+//   ./evaluate [-n synthetic_n] [-j worker_n] [-r seed] [-c] [script ...]
+//
+// Sessions are the given scripts plus synthetic_n variations of the built-in
+// scenarios with CPU/GPU work scaled by 70-130%. Workers are forked processes,
+// each with its own copy of the governor globals, and take the next session
+// from a shared counter until none are left.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "workload.h"
+
+#define SCRIPT_MAX 256
+
+typedef struct {
+    int script;             // index into scripts, -1 = synthetic
+    unsigned int seed;
+} DC_Session;
+
+typedef struct {
+    long session_next;      // next session to take
+    DC_Stats stats[];       // session_n * GOVERNOR_N
+} DC_Shared;
+
+static const char *g_script[SCRIPT_MAX];
+static int g_script_n = 0;
+static int g_calibrate = 0;
+
+static int getSessionPhases(const DC_Session *session, DC_Phase *phase)
+{
+    if (session->script >= 0)
+        return loadScript(g_script[session->script], phase);
+    return getSyntheticScenario(session->seed, phase);
+}
+
+static void runWorker(DC_Shared *shared, const DC_Session *session, long session_n)
+{
+    DC_Phase phase[PHASE_MAX];
+
+    while (1) {
+        long s = __sync_fetch_and_add(&shared->session_next, 1);
+        if (s >= session_n)
+            break;
+
+        int phase_n = getSessionPhases(&session[s], phase);
+        if (phase_n < 0)
+            continue;
+
+        for (int g = 0; g < GOVERNOR_N; g++)
+            runWorkload(g, phase, phase_n, session[s].seed, g_calibrate, NULL, &shared->stats[s * GOVERNOR_N + g]);
+    }
+}
+
+static void printSummary(const DC_Shared *shared, long session_n)
+{
+    printf("%-8s %8s %9s %8s %9s %8s %9s %8s %11s\n",
+           "governor", "sessions", "missed %", "worst %", "stutter %", "avg fps", "mJ/frame", "avg mW", "changes/min");
+
+    for (int g = 0; g < GOVERNOR_N; g++) {
+        DC_Stats total;
+        double missed_worst = 0;
+        long n = 0;
+
+        memset(&total, 0, sizeof(total));
+        for (long s = 0; s < session_n; s++) {
+            const DC_Stats *stats = &shared->stats[s * GOVERNOR_N + g];
+            if (stats->frame_n == 0)
+                continue;
+
+            double missed = 100.0 * stats->dropped_n / stats->frame_n;
+            if (missed > missed_worst)
+                missed_worst = missed;
+            addStats(&total, stats);
+            n++;
+        }
+
+        printf("%-8s %8ld %9.2f %8.2f %9.2f %8.1f %9.2f %8.0f %11.1f\n",
+               g_governors[g]->name, n,
+               total.frame_n > 0 ? 100.0 * total.dropped_n / total.frame_n : 0,
+               missed_worst,
+               total.frame_n > 0 ? 100.0 * total.stutter_n / total.frame_n : 0,
+               total.duration > 0 ? total.frame_n * (double)SECOND / total.duration : 0,
+               total.frame_n > 0 ? total.energy / 1000.0 / total.frame_n : 0,
+               total.duration > 0 ? total.energy * 1000.0 / total.duration : 0,
+               total.duration > 0 ? total.transition_n * 60.0 * SECOND / total.duration : 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long synthetic_n = 0;
+    long worker_n = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            synthetic_n = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            worker_n = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-c")) {
+            g_calibrate = 1;
+        } else if (argv[i][0] != '-' && g_script_n < SCRIPT_MAX) {
+            g_script[g_script_n++] = argv[i];
+        } else {
+            fprintf(stderr, "usage: evaluate [-n synthetic_n] [-j worker_n] [-r seed] [-c] [script ...]\n");
+            return 1;
+        }
+    }
+
+    long session_n = g_script_n + synthetic_n;
+    if (session_n == 0)
+        synthetic_n = session_n = 1000;
+    if (worker_n < 1)
+        worker_n = 1;
+
+    DC_Session *session = malloc(session_n * sizeof(DC_Session));
+    for (long s = 0; s < session_n; s++) {
+        session[s].script = s < g_script_n ? (int)s : -1;
+        session[s].seed = seed + (unsigned int)s * 7919;
+    }
+
+    size_t shared_size = sizeof(DC_Shared) + session_n * GOVERNOR_N * sizeof(DC_Stats);
+    DC_Shared *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(shared, 0, shared_size);
+
+    buildFreqTable();
+
+    for (long w = 0; w < worker_n; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            runWorker(shared, session, session_n);
+            _exit(0);
+        }
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+    }
+    while (wait(NULL) > 0)
+        ;
+
+    printf("%ld sessions (%d scripts, %ld synthetic), %ld workers\n\n", session_n, g_script_n, synthetic_n, worker_n);
+    printSummary(shared, session_n);
+
+    munmap(shared, shared_size);
+    free(session);
+    return 0;
+}
@@ -0,0 +1,365 @@
+// Fuzz the governors and overlay drawing with random input, checking invariants
+//
+//   cc -O2 -std=gnu99 -I.. -Ihost -o fuzz fuzz.c ../menu.c ../audit.c ../datafile.c ../display.c ../pace.c ../freq.c ../governor.c
+//   ./fuzz [-n iteration_n] [-r seed]
+//
+// Governors get random frametimes, ceilings, pinned domains, governor
+// switches, input boosts and suspends. Requested clocks must stay valid
+// steps within the frame's floor and ceiling, and every bump must respect
+// its cooldown. drawString and drawStringF get random strings and positions
+// on framebuffers of random size and pitch, nothing may be written outside
+// the visible area. checkButtons and updateMenu get random controller
+// states, every g_config index must stay in range and the menu must draw
+// within the framebuffer. Exits 1 on the first violation with the seed to
+// replay it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <psp2/display.h>
+#include <psp2/ctrl.h>
+
+#include "display.h"
+#include "freq.h"
+#include "governor.h"
+#include "menu.h"
+
+#define FB_WIDTH_MAX        1024
+#define FB_HEIGHT_MAX       600
+#define FB_GUARD            4096            // canary pixels around the framebuffer
+#define CANARY              0xDEADBEEF
+#define STRING_MAX          600             // over drawStringF's 512 on purpose
+#define FRAME_N             4000            // frames per governor session
+#define INPUT_N             400             // controller states per menu session
+
+typedef struct {
+    long since_up;          // frames since clocks were bumped up
+    long since_down;        // frames since clocks were bumped down
+} DC_Cooldown;
+
+static unsigned int g_seed;
+static long g_iteration;
+static uint32_t g_fb[FB_GUARD + FB_WIDTH_MAX * FB_HEIGHT_MAX + FB_GUARD];
+
+static unsigned int randomInt(unsigned int n)
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return n > 0 ? (g_seed >> 8) % n : 0;
+}
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "iteration %ld: %s\n", g_iteration, what);
+    exit(1);
+}
+
+static int isFreqStep(int index, int freq)
+{
+    return g_freq_step[index][getFreqStep(index, freq)] == freq;
+}
+
+// Requested clocks as the hook would read them
+static void checkRange(int governor, const DC_Frame *frame)
+{
+    DC_GovernorState state;
+    g_governors[governor]->snapshot(&state);
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        int freq = state.freq[i];
+        if (!isFreqStep(i, freq))
+            fail("requested clock is not a step");
+        if (freq > frame->freq_max[i])
+            fail("requested clock above ceiling");
+        if (freq < frame->freq_min[i] && frame->freq_min[i] <= frame->freq_max[i])
+            fail("requested clock below floor");
+    }
+}
+
+static void checkCooldown(int governor, int reason, DC_Cooldown *cooldown)
+{
+    DC_GovernorAudit audit;
+    g_governors[governor]->audit(&audit);
+
+    cooldown->since_up++;
+    cooldown->since_down++;
+
+    if (reason == REASON_DROP) {
+        if (audit.frame_n_since_up <= audit.cooldown_up || cooldown->since_up <= g_frame_n_cooldown_up)
+            fail("bumped up within cooldown");
+        cooldown->since_up = 0;
+    } else if (reason == REASON_HEADROOM) {
+        if (audit.cooldown_down < g_frame_n_cooldown_down)
+            fail("bump down cooldown narrower than configured");
+        if (cooldown->since_up <= audit.cooldown_down || cooldown->since_down <= audit.cooldown_down)
+            fail("bumped down within cooldown");
+        cooldown->since_down = 0;
+    }
+}
+
+static int randomStep(int index)
+{
+    return g_freq_step[index][randomInt(g_freq_step_n[index])];
+}
+
+// Ceilings move with battery and power cap, pinned domains like in the hook
+static void randomRange(int freq_min[CLOCK_N], int freq_max[CLOCK_N], const int freq[CLOCK_N])
+{
+    for (int i = 0; i < CLOCK_N; i++) {
+        switch (randomInt(4)) {
+        case 0:
+            freq_min[i] = freq[i];
+            freq_max[i] = freq[i];
+            break;
+        case 1:
+            freq_min[i] = g_freq_dynamic_min[i];
+            freq_max[i] = randomStep(i);
+            break;
+        default:
+            freq_min[i] = g_freq_dynamic_min[i];
+            freq_max[i] = g_freq_step[i][g_freq_step_n[i] - 1];
+            break;
+        }
+    }
+}
+
+static void fuzzGovernor(int governor)
+{
+    DC_GovernorState state;
+    DC_Cooldown cooldown = {0, 0};
+    int freq_min[CLOCK_N];
+    int freq_max[CLOCK_N];
+    int fps = randomInt(2) ? 60 : 30;
+    int exact = randomInt(4) == 0;
+
+    g_drop_frametime_diff = 500 + randomInt(6000);
+    g_frame_n_cooldown_up = 1 + randomInt(8);
+    g_frame_n_cooldown_down = 10 + randomInt(300);
+    g_input_boost_frame_n = randomInt(3) * 60;
+
+    // Cold start or warm start from a profile
+    for (int i = 0; i < CLOCK_N; i++) {
+        state.freq[i] = randomStep(i);
+        state.sensitivity[i] = randomInt(2) ? 0 : randomInt(SECOND * 100);
+    }
+    g_governors[governor]->init(randomInt(2) ? NULL : &state);
+    g_governors[governor]->snapshot(&state);
+    randomRange(freq_min, freq_max, state.freq);
+
+    for (int n = 0; n < FRAME_N; n++) {
+        DC_Frame frame;
+        g_governors[governor]->snapshot(&state);
+
+        // Settings changed from the menu
+        if (randomInt(200) == 0)
+            randomRange(freq_min, freq_max, state.freq);
+        if (randomInt(500) == 0)
+            g_input_boost_frame_n = randomInt(3) * 60;
+
+        // Loading, idle or sleep
+        if (randomInt(1000) == 0) {
+            g_governors[governor]->on_suspend();
+            cooldown.since_up = 0;
+            cooldown.since_down = 0;
+        }
+        if (randomInt(50) == 0)
+            g_governors[governor]->on_input();
+
+        frame.frametime_target = SECOND / fps;
+        frame.frametime = frame.frametime_target * (50 + randomInt(120)) / 100;
+        if (randomInt(100) == 0)
+            frame.frametime *= 4;
+        frame.exact = exact;
+        frame.dropped = frame.frametime >= frame.frametime_target + g_drop_frametime_diff;
+        for (int i = 0; i < CLOCK_N; i++) {
+            frame.freq[i] = state.freq[i];
+            frame.freq_min[i] = freq_min[i];
+            frame.freq_max[i] = freq_max[i];
+        }
+
+        int reason = g_governors[governor]->on_frame(&frame);
+        if (reason < REASON_NONE || reason >= REASON_N)
+            fail("unknown reason");
+
+        checkRange(governor, &frame);
+        checkCooldown(governor, reason, &cooldown);
+    }
+}
+
+// Glyphs must land inside width x height, pitch padding and guards untouched
+static void checkFramebuf(int width, int height, int pitch)
+{
+    uint32_t *fb = g_fb + FB_GUARD;
+
+    for (int i = 0; i < FB_GUARD; i++) {
+        if (g_fb[i] != CANARY || fb[pitch * height + i] != CANARY)
+            fail("write outside framebuffer");
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = width; x < pitch; x++) {
+            if (fb[y * pitch + x] != CANARY)
+                fail("write into pitch padding");
+        }
+    }
+}
+
+static void fuzzDraw()
+{
+    char str[STRING_MAX + 1];
+    int pitch = 1 + randomInt(FB_WIDTH_MAX);
+    int width = randomInt(4) ? pitch : 1 + randomInt(FB_WIDTH_MAX + 64);
+    int height = 1 + randomInt(FB_HEIGHT_MAX);
+
+    for (int i = 0; i < FB_GUARD + pitch * height + FB_GUARD; i++)
+        g_fb[i] = CANARY;
+
+    // Width over pitch happens with odd games, only the pitch is drawable then
+    SceDisplayFrameBuf param = {sizeof(param), g_fb + FB_GUARD, pitch, 0, width, height};
+    updateFramebuf(&param);
+    if (width > pitch)
+        width = pitch;
+
+    int len = randomInt(STRING_MAX);
+    for (int i = 0; i < len; i++)
+        str[i] = 1 + randomInt(255);
+    str[len] = '\0';
+
+    int x = (int)randomInt(2 * pitch) - pitch / 2;
+    int y = (int)randomInt(2 * height) - height / 2;
+    if (randomInt(2))
+        drawString(x, y, str);
+    else
+        drawStringF(x, y, "%s", str);
+
+    checkFramebuf(width, height, pitch);
+}
+
+static void checkConfig(int event)
+{
+    DC_Config config;
+    readConfig(&config);
+
+    if (event & ~(MENU_EVENT_APPLY | MENU_EVENT_POWER_CAP | MENU_EVENT_AUDIT))
+        fail("unknown menu event");
+    if (config.menu < MENU_HIDDEN || config.menu >= MENU_N)
+        fail("menu out of range");
+    if (config.selected < MENU_ITEM_CPU || config.selected >= MENU_ITEM_N)
+        fail("selected item out of range");
+    for (int i = 0; i < CLOCK_N; i++) {
+        if (config.mode[i] < MODE_DYNAMIC || config.mode[i] >= MODE_N)
+            fail("mode out of range");
+        if (config.governor[i] < 0 || config.governor[i] >= GOVERNOR_N)
+            fail("governor out of range");
+        if (config.freq_current_step[i] < 0 || config.freq_current_step[i] >= g_freq_step_n[i])
+            fail("manual step out of range");
+    }
+    if (config.input_boost_frame_n < 0 || config.input_boost_frame_n > INPUT_BOOST_FRAME_N_MAX ||
+            config.input_boost_frame_n % INPUT_BOOST_FRAME_N_STEP != 0)
+        fail("input boost out of range");
+    if (config.power_cap != 0 && (config.power_cap < POWER_CAP_MIN || config.power_cap > POWER_CAP_MAX))
+        fail("power cap out of range");
+    if (g_input_boost_frame_n != config.input_boost_frame_n)
+        fail("input boost not handed to governors");
+}
+
+// Menu buttons most of the time, anything else now and then
+static unsigned int randomButtons()
+{
+    static const unsigned int menu_button[] = {
+        SCE_CTRL_SELECT, SCE_CTRL_UP, SCE_CTRL_DOWN, SCE_CTRL_LEFT, SCE_CTRL_RIGHT, SCE_CTRL_SQUARE
+    };
+    unsigned int buttons = 0;
+
+    if (randomInt(8) == 0)
+        return randomInt(0xFFFFFFFF);
+    for (int i = 0; i < 6; i++) {
+        if (randomInt(3) == 0)
+            buttons |= menu_button[i];
+    }
+    return buttons;
+}
+
+// Input threads poll several times per frame, the display hook acts once per frame
+static void fuzzMenu()
+{
+    SceCtrlData ctrl;
+    int width = 960;
+    int height = 544;
+    uint32_t *fb = g_fb + FB_GUARD;
+
+    for (int i = 0; i < FB_GUARD + width * height + FB_GUARD; i++)
+        g_fb[i] = CANARY;
+    SceDisplayFrameBuf param = {sizeof(param), fb, width, 0, width, height};
+    updateFramebuf(&param);
+
+    // Governor sessions set their own boost, only the menu does in the plugin
+    g_input_boost_frame_n = g_config.input_boost_frame_n;
+
+    memset(&ctrl, 0, sizeof(ctrl));
+    for (int n = 0; n < INPUT_N; n++) {
+        int poll_n = 1 + randomInt(4);
+        for (int p = 0; p < poll_n; p++) {
+            ctrl.buttons = randomInt(2) ? randomButtons() : ctrl.buttons;
+            ctrl.lx = randomInt(256);
+            ctrl.ly = randomInt(256);
+            ctrl.rx = randomInt(256);
+            ctrl.ry = randomInt(256);
+            checkButtons(&ctrl);
+        }
+
+        checkConfig(updateMenu());
+
+        DC_MenuStatus status;
+        for (int i = 0; i < CLOCK_N; i++) {
+            status.freq[i] = randomStep(i);
+            status.freq_config[i] = randomStep(i);
+        }
+        status.battery_low = randomInt(2);
+        status.battery_hot = randomInt(2);
+        status.power = randomInt(5000);
+        status.energy = randomInt(0x7FFFFFFF) * 1000LL;
+        status.frame_n = randomInt(0x7FFFFFFF);
+        status.transition_n = randomInt(0x7FFFFFFF);
+        if (g_config.menu != MENU_HIDDEN)
+            drawMenu(&status);
+    }
+
+    for (int i = 0; i < FB_GUARD; i++) {
+        if (g_fb[i] != CANARY || fb[width * height + i] != CANARY)
+            fail("menu drawn outside framebuffer");
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: fuzz [-n iteration_n] [-r seed]\n");
+}
+
+int main(int argc, char **argv)
+{
+    long iteration_n = 2000;
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iteration_n = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    buildFreqTable();
+    g_calibration_cpu_share = -1;
+    g_seed = seed;
+
+    for (g_iteration = 0; g_iteration < iteration_n; g_iteration++) {
+        fuzzGovernor(randomInt(GOVERNOR_N));
+        for (int i = 0; i < 16; i++)
+            fuzzDraw();
+        fuzzMenu();
+    }
+
+    printf("%ld iterations, seed %u, no violations\n", iteration_n, seed);
+    return 0;
+}
@@ -0,0 +1,2 @@
+// Host stand-in, libk mirrors the C library
+#include <string.h>
@@ -0,0 +1,16 @@
+// Host stand-in for the VitaSDK header, only what display.c and menu.c use
+#ifndef _PSP2_DISPLAY_H_
+#define _PSP2_DISPLAY_H_
+
+#include <psp2/types.h>
+
+typedef struct SceDisplayFrameBuf {
+    SceSize size;
+    void *base;
+    unsigned int pitch;
+    unsigned int pixelformat;
+    unsigned int width;
+    unsigned int height;
+} SceDisplayFrameBuf;
+
+#endif
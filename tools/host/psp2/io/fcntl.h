@@ -0,0 +1,35 @@
+// Host stand-in for the VitaSDK header, only what datafile.c uses
+#ifndef _PSP2_IO_FCNTL_H_
+#define _PSP2_IO_FCNTL_H_
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <psp2/types.h>
+
+#define SCE_O_RDONLY O_RDONLY
+#define SCE_O_WRONLY O_WRONLY
+#define SCE_O_CREAT  O_CREAT
+#define SCE_O_TRUNC  O_TRUNC
+#define SCE_O_APPEND O_APPEND
+
+static inline SceUID sceIoOpen(const char *file, int flags, int mode)
+{
+    return open(file, flags, mode);
+}
+
+static inline int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+    return read(fd, data, size);
+}
+
+static inline int sceIoWrite(SceUID fd, const void *data, SceSize size)
+{
+    return write(fd, data, size);
+}
+
+static inline int sceIoClose(SceUID fd)
+{
+    return close(fd);
+}
+
+#endif
@@ -0,0 +1,13 @@
+// Host stand-in for the VitaSDK header, only what datafile.c uses
+#ifndef _PSP2_IO_STAT_H_
+#define _PSP2_IO_STAT_H_
+
+#include <sys/stat.h>
+#include <psp2/types.h>
+
+static inline int sceIoMkdir(const char *dir, int mode)
+{
+    return mkdir(dir, mode);
+}
+
+#endif
@@ -0,0 +1,13 @@
+// Host stand-in for the VitaSDK header, only what menu.c uses
+#ifndef _PSP2_KERNEL_THREADMGR_H_
+#define _PSP2_KERNEL_THREADMGR_H_
+
+#include <unistd.h>
+#include <psp2/types.h>
+
+static inline int sceKernelDelayThread(SceUInt32 delay)
+{
+    return usleep(delay);
+}
+
+#endif
@@ -0,0 +1,12 @@
+// Host stand-in for the VitaSDK header, only what the host tools build
+#ifndef _PSP2_TYPES_H_
+#define _PSP2_TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef unsigned int SceSize;
+typedef uint32_t SceUInt32;
+typedef int SceUID;
+
+#endif
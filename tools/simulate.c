@@ -0,0 +1,97 @@
+// Host replay of the dynamic governors on a synthetic workload, no hardware needed
+//
+//   cc -O2 -std=gnu99 -I.. -o simulate simulate.c workload.c ../pace.c ../freq.c ../governor.c
+//   ./simulate [-s scenario] [-f script] [-g ladder|search|all] [-r seed] [-c]
+//
+// Script format is described in workload.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "workload.h"
+
+static void printStats(const char *name, const DC_Stats *stats)
+{
+    printf("  %-10s %7ld %7ld %7ld %8.1f %9.2f %8.0f %8ld\n",
+           name, stats->frame_n, stats->dropped_n, stats->stutter_n,
+           stats->duration > 0 ? stats->frame_n * (double)SECOND / stats->duration : 0,
+           stats->frame_n > 0 ? stats->energy / 1000.0 / stats->frame_n : 0,
+           stats->duration > 0 ? stats->energy * 1000.0 / stats->duration : 0,
+           stats->transition_n);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: simulate [-s scenario] [-f script] [-g ladder|search|all] [-r seed] [-c]\n");
+    fprintf(stderr, "scenarios:");
+    for (int i = 0; i < g_scenario_n; i++)
+        fprintf(stderr, " %s", g_scenarios[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    DC_Phase phase[PHASE_MAX];
+    DC_Stats phase_stats[PHASE_MAX];
+    DC_Stats total;
+    const char *scenario = "mixed";
+    const char *script = NULL;
+    int governor = -1;
+    unsigned int seed = 1;
+    int calibrate = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            scenario = argv[++i];
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            script = argv[++i];
+        } else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+            governor = -1;
+            i++;
+            for (int g = 0; g < GOVERNOR_N; g++) {
+                if (!strcasecmp(argv[i], g_governors[g]->name))
+                    governor = g;
+            }
+            if (governor < 0 && strcmp(argv[i], "all")) {
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-c")) {
+            calibrate = 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    int phase_n = script ? loadScript(script, phase) : getScenario(scenario, phase);
+    if (phase_n < 0) {
+        usage();
+        return 1;
+    }
+
+    buildFreqTable();
+
+    // Every governor sees the same noise
+    for (int g = 0; g < GOVERNOR_N; g++) {
+        if (governor >= 0 && g != governor)
+            continue;
+
+        runWorkload(g, phase, phase_n, seed, calibrate, phase_stats, &total);
+
+        printf("%s\n", g_governors[g]->name);
+        printf("  %-10s %7s %7s %7s %8s %9s %8s %8s\n",
+               "phase", "frames", "missed", "stutter", "avg fps", "mJ/frame", "avg mW", "changes");
+        for (int p = 0; p < phase_n; p++)
+            printStats(phase[p].name, &phase_stats[p]);
+        printStats("total", &total);
+        printf("  oscillations %ld, energy %.1f J\n\n", total.oscillation_n, total.energy / 1000000.0);
+    }
+
+    return 0;
+}
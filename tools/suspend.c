@@ -0,0 +1,178 @@
+// Replay suspend, idle and loading gaps through the frame pacing of the display hook
+//
+//   cc -O2 -std=gnu99 -I.. -o suspend suspend.c ../pace.c ../freq.c ../governor.c
+//   ./suspend
+//
+// Frames go through pace.c like in sceDisplaySetFrameBuf_patched, resumes
+// like in powerCallback and idle polls like in watchdogThread. Exits 1 when
+// a gap is taken for a frame: loading entered, target FPS moved or clocks
+// bumped on the first frame back.
+#include <stdio.h>
+#include <stdint.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "pace.h"
+
+#define VBLANK_US           16667
+
+static uint32_t g_tick = 0x80000000;    // process time, wraps like on device
+static int g_vcount = 0;
+static int g_fail_n = 0;
+
+static DC_PaceFrame g_pace;             // last presented frame
+static int g_gov_reason = REASON_NONE;  // last governor decision
+static int g_poll_hook = 0;             // watchdog polls while the hook runs
+static int g_poll_idle = 0;             // what that poll returned
+
+static void check(int ok, const char *what)
+{
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+        g_fail_n++;
+}
+
+static void getFrameFreq(int freq[CLOCK_N])
+{
+    DC_GovernorState state;
+    g_governors[GOVERNOR_LADDER]->snapshot(&state);
+    for (int i = 0; i < CLOCK_N; i++)
+        freq[i] = state.freq[i];
+}
+
+// Present one frame after vblank_n vblanks, DC_PaceEvent flags
+static int presentFrame(int vblank_n)
+{
+    g_tick += vblank_n * VBLANK_US;
+    g_vcount += vblank_n;
+
+    measurePace(g_tick, g_vcount, 0, &g_pace);
+    int event = stepPace(&g_pace);
+    if (event & PACE_RESET) {
+        for (int i = 0; i < GOVERNOR_N; i++)
+            g_governors[i]->on_suspend();
+        suspendCalibration();
+    }
+    if (g_poll_hook)
+        g_poll_idle = updatePaceIdle(g_tick + VBLANK_US / 2);
+    updatePaceTarget(&g_pace, 0);
+
+    DC_Frame frame;
+    frame.frametime = g_pace.real_frametime;
+    frame.frametime_target = g_frametime_target;
+    frame.exact = 0;
+    frame.dropped = isPaceDropped(&g_pace, g_frametime_target + g_drop_frametime_diff);
+    getFrameFreq(frame.freq);
+    for (int i = 0; i < CLOCK_N; i++) {
+        frame.freq_min[i] = g_freq_dynamic_min[i];
+        frame.freq_max[i] = g_freq_step[i][g_freq_step_n[i] - 1];
+    }
+
+    g_gov_reason = REASON_NONE;
+    if (!g_loading && g_pace.frametime < g_loading_frametime)
+        g_gov_reason = g_governors[GOVERNOR_LADDER]->on_frame(&frame);
+
+    endPace(g_tick, g_tick, g_vcount);
+    return event;
+}
+
+static void presentFrames(int n, int vblank_n)
+{
+    for (int i = 0; i < n; i++)
+        presentFrame(vblank_n);
+}
+
+// Nothing presented for gap, the watchdog polls every 250 ms meanwhile
+static void pollIdle(long gap)
+{
+    uint32_t tick = g_tick;
+    for (long t = SECOND / 4; t <= gap; t += SECOND / 4)
+        updatePaceIdle(tick + t);
+    g_tick += gap;
+    g_vcount += gap / VBLANK_US;
+}
+
+static void checkFirstFrame(int event, int fps_target)
+{
+    check(event & PACE_RESUME, "gap reported as a resume");
+    check(g_pace.frametime == g_frametime_target, "gap replaced by target frametime");
+    check(!isPaceDropped(&g_pace, g_frametime_target + g_drop_frametime_diff), "first frame back not dropped");
+    check(!g_loading, "loading not entered");
+    check(g_gov_reason != REASON_DROP, "clocks not bumped");
+    check(g_fps_target_stable == fps_target, "target FPS kept");
+}
+
+static void startSession(int vblank_n)
+{
+    g_governors[GOVERNOR_LADDER]->init(NULL);
+    endPace(g_tick, g_tick, g_vcount);
+    presentFrames(600, vblank_n);
+}
+
+int main()
+{
+    buildFreqTable();
+    g_calibration_cpu_share = -1;
+
+    printf("suspend at 60 FPS, 10 min asleep\n");
+    startSession(1);
+    g_tick += 600 * SECOND;
+    g_vcount += 100;
+    resumePace(g_tick);
+    checkFirstFrame(presentFrame(1), 60);
+    presentFrames(120, 1);
+    check(g_fps_target_stable == 60 && !g_loading, "still 60 FPS two seconds later");
+
+    printf("suspend at 30 FPS, process time wraps while asleep\n");
+    startSession(2);
+    g_tick = 0xFFFFFFFF - 3 * VBLANK_US;
+    g_vcount += 30;
+    resumePace(g_tick);
+    checkFirstFrame(presentFrame(2), 30);
+    presentFrame(2);
+    check(g_pace.frametime == 2 * VBLANK_US, "frametime measured across the wrap");
+
+    printf("idle gap, 5 s without frames\n");
+    startSession(1);
+    pollIdle(SECOND * 5);
+    check(g_idle == IDLE_GAP, "watchdog raced it like loading");
+    checkFirstFrame(presentFrame(1), 60);
+
+    printf("deep idle, 40 s without frames\n");
+    startSession(1);
+    pollIdle(SECOND * 40);
+    check(g_idle == IDLE_DEEP, "watchdog dropped to lowest clocks");
+    checkFirstFrame(presentFrame(1), 60);
+
+    printf("watchdog polls while the first frame back runs\n");
+    startSession(1);
+    pollIdle(SECOND * 5);
+    g_poll_hook = 1;
+    checkFirstFrame(presentFrame(1), 60);
+    g_poll_hook = 0;
+    check(!g_poll_idle && g_idle == IDLE_OFF, "idle not entered again");
+
+    printf("suspend while idle\n");
+    startSession(1);
+    pollIdle(SECOND * 5);
+    resumePace(g_tick);
+    check(!updatePaceIdle(g_tick + g_idle_frametime_deep), "watchdog leaves the pending resume alone");
+    checkFirstFrame(presentFrame(1), 60);
+    check(g_idle == IDLE_OFF && !g_resumed, "idle and resume cleared");
+
+    printf("loading screen, frames every 500 ms\n");
+    startSession(1);
+    presentFrame(30);
+    int event = presentFrame(30);
+    check((event & PACE_LOADING) && g_loading, "loading entered on second slow frame");
+    presentFrames(g_loading_frame_n_exit - 1, 1);
+    event = presentFrame(1);
+    check((event & PACE_RESET) && !g_loading, "loading left after normal cadence");
+
+    if (g_fail_n > 0) {
+        printf("%d checks failed\n", g_fail_n);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
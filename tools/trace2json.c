@@ -0,0 +1,151 @@
+// Convert an on-device frame recording to trace-event JSON
+//
+//   cc -O2 -std=gnu99 -I.. -o trace2json trace2json.c ../freq.c ../governor.c
+//   ./trace2json TITLEID_trace.bin [out.json]
+//
+// Recordings are written by builds configured with -DTRACE=ON to
+// ux0:data/DynClockVita/<titleid>_trace.bin. Open the output in
+// chrome://tracing or ui.perfetto.dev: frames and hook time are slices,
+// clocks are counter tracks, clock changes are instants with their reason.
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "trace.h"
+
+#define TID_FRAME       1
+#define TID_HOOK        2
+#define TID_GOVERNOR    3
+
+#define ASYNC_LOADING       1
+#define ASYNC_CALIBRATING   2
+
+static const char *g_clock_name[TRACE_CLOCK_N] = {"CPU", "BUS", "GPU"};
+
+static void printEvent(FILE *out, int *first, const char *fmt, ...)
+{
+    va_list args;
+
+    fprintf(out, "%s\n", *first ? "" : ",");
+    *first = 0;
+
+    va_start(args, fmt);
+    vfprintf(out, fmt, args);
+    va_end(args);
+}
+
+static void printThreadName(FILE *out, int *first, int tid, const char *name)
+{
+    printEvent(out, first, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+               tid, name);
+}
+
+int main(int argc, char **argv)
+{
+    DC_TraceHeader header;
+    DC_TraceRecord record;
+    int freq_last[TRACE_CLOCK_N] = {-1, -1, -1};
+    int flags_last = 0;
+    uint32_t tick_last = 0;
+    long long ts = 0;               // us since first record, tick unwrapped
+    long record_n = 0;
+    int first = 1;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: trace2json TITLEID_trace.bin [out.json]\n");
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+            header.magic != TRACE_MAGIC ||
+            header.version != TRACE_VERSION ||
+            header.record_size != sizeof(DC_TraceRecord)) {
+        fprintf(stderr, "%s: not a version %d frame recording\n", argv[1], TRACE_VERSION);
+        fclose(in);
+        return 1;
+    }
+
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    printEvent(out, &first, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"DynClockVita\"}}");
+    printThreadName(out, &first, TID_FRAME, "frames");
+    printThreadName(out, &first, TID_HOOK, "display hook");
+    printThreadName(out, &first, TID_GOVERNOR, "governor");
+
+    while (fread(&record, sizeof(record), 1, in) == 1) {
+        // Process time wraps every ~71 min, only deltas are meaningful
+        if (record_n > 0)
+            ts += (uint32_t)(record.tick - tick_last);
+        tick_last = record.tick;
+
+        long long frame_ts = ts - record.frametime;
+        if (frame_ts < 0)
+            frame_ts = 0;
+
+        printEvent(out, &first,
+                   "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lu,"
+                   "\"args\":{\"frametime_us\":%lu,\"fps_target\":%d,\"dropped\":%d,\"loading\":%d,"
+                   "\"calibrating\":%d,\"uncapped\":%d}}",
+                   record.flags & TRACE_DROPPED ? "frame (dropped)" : "frame", TID_FRAME,
+                   frame_ts, (unsigned long)(ts - frame_ts), (unsigned long)record.frametime, record.fps_target,
+                   !!(record.flags & TRACE_DROPPED), !!(record.flags & TRACE_LOADING),
+                   !!(record.flags & TRACE_CALIBRATING), !!(record.flags & TRACE_UNCAPPED));
+
+        printEvent(out, &first,
+                   "{\"name\":\"hook\",\"cat\":\"hook\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%u}",
+                   TID_HOOK, ts, record.hook_time);
+
+        // Counter tracks only change with the clocks
+        for (int i = 0; i < TRACE_CLOCK_N; i++) {
+            if (record.freq[i] == freq_last[i])
+                continue;
+            printEvent(out, &first,
+                       "{\"name\":\"%s MHz\",\"cat\":\"clock\",\"ph\":\"C\",\"pid\":1,\"ts\":%lld,\"args\":{\"MHz\":%u}}",
+                       g_clock_name[i], ts, record.freq[i]);
+            freq_last[i] = record.freq[i];
+        }
+
+        if (record.reason != REASON_NONE) {
+            const char *reason = record.reason < REASON_N ? g_reason_name[record.reason] : "unknown";
+            const char *governor = record.governor < GOVERNOR_N ? g_governors[record.governor]->name : "";
+            printEvent(out, &first,
+                       "{\"name\":\"%s\",\"cat\":\"decision\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%lld,"
+                       "\"args\":{\"reason\":\"%s\",\"governor\":\"%s\",\"CPU\":%u,\"BUS\":%u,\"GPU\":%u}}",
+                       reason, TID_GOVERNOR, ts, reason, governor,
+                       record.freq[CLOCK_CPU], record.freq[CLOCK_BUS], record.freq[CLOCK_GPU]);
+        }
+
+        // Loading and calibration may overlap, async spans don't have to nest
+        int changed = (record.flags ^ flags_last) & (TRACE_LOADING | TRACE_CALIBRATING);
+        if (changed & TRACE_LOADING)
+            printEvent(out, &first, "{\"name\":\"loading\",\"cat\":\"state\",\"ph\":\"%c\",\"id\":%d,\"pid\":1,\"ts\":%lld}",
+                       record.flags & TRACE_LOADING ? 'b' : 'e', ASYNC_LOADING, ts);
+        if (changed & TRACE_CALIBRATING)
+            printEvent(out, &first, "{\"name\":\"calibrating\",\"cat\":\"state\",\"ph\":\"%c\",\"id\":%d,\"pid\":1,\"ts\":%lld}",
+                       record.flags & TRACE_CALIBRATING ? 'b' : 'e', ASYNC_CALIBRATING, ts);
+        flags_last = record.flags;
+
+        record_n++;
+    }
+
+    fprintf(out, "\n]}\n");
+    fprintf(stderr, "%ld frames, %.1f s\n", record_n, ts / (double)SECOND);
+
+    if (out != stdout)
+        fclose(out);
+    fclose(in);
+    return 0;
+}
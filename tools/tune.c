@@ -0,0 +1,309 @@
+// Tune governor parameters offline, lowest energy within a bad frame budget
+//
+//   cc -O2 -std=gnu99 -I.. -o tune tune.c workload.c ../pace.c ../freq.c ../governor.c
+//   ./tune [-g ladder|search] [-m stutter|missed] [-b budget_percent] [-n synthetic_n]
+//          [-r seed] [-c] [-o TITLEID.bin] [script ...]
+//
+// Grid over drop threshold and cooldowns, then refines the best point one
+// parameter at a time. The budget counts stutters (frames taking twice the
+// target) by default, -m missed counts every frame over target instead.
+// -o writes a profile for ux0:data/DynClockVita/, the tuned values are
+// loaded on next launch of that title. An existing profile (copied from the
+// device) keeps everything it learned, only the tuned values are replaced.
+// Ladder is tuned by default, it is the device default too.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "profile.h"
+#include "workload.h"
+
+#define SCRIPT_MAX  256
+#define REFINE_MAX  32
+
+typedef struct {
+    long drop_frametime_diff;   // us
+    long frame_n_cooldown_up;
+    long frame_n_cooldown_down;
+} DC_Params;
+
+typedef enum {
+	METRIC_STUTTER = 0,
+	METRIC_MISSED  = 1,
+	METRIC_N       = 2
+} DC_Metric;
+
+typedef struct {
+    double bad;                 // % of frames counted against the budget
+    double energy;              // mJ/frame
+} DC_Score;
+
+static const char *g_metric_name[METRIC_N] = {"stutter", "missed"};
+
+static const long g_grid_drop[]     = {1000, 2000, 3000, 4000, 6000};
+static const long g_grid_up[]       = {1, 2, 4, 8};
+static const long g_grid_down[]     = {30, 60, 120, 240, 480};
+
+static DC_Phase g_phase[SCRIPT_MAX][PHASE_MAX];
+static int g_phase_n[SCRIPT_MAX];
+static unsigned int g_seed[SCRIPT_MAX];
+static int g_session_n = 0;
+
+static int g_governor = GOVERNOR_LADDER;
+static int g_metric = METRIC_STUTTER;
+static double g_budget = 1.0;
+static int g_calibrate = 0;
+static long g_eval_n = 0;
+
+static DC_Score evaluate(const DC_Params *params)
+{
+    DC_Stats total;
+    DC_Stats stats;
+    DC_Score score;
+
+    g_drop_frametime_diff = params->drop_frametime_diff;
+    g_frame_n_cooldown_up = params->frame_n_cooldown_up;
+    g_frame_n_cooldown_down = params->frame_n_cooldown_down;
+
+    memset(&total, 0, sizeof(total));
+    for (int s = 0; s < g_session_n; s++) {
+        runWorkload(g_governor, g_phase[s], g_phase_n[s], g_seed[s], g_calibrate, NULL, &stats);
+        addStats(&total, &stats);
+    }
+    g_eval_n++;
+
+    long bad_n = g_metric == METRIC_STUTTER ? total.stutter_n : total.dropped_n;
+    score.bad = total.frame_n > 0 ? 100.0 * bad_n / total.frame_n : 0;
+    score.energy = total.frame_n > 0 ? total.energy / 1000.0 / total.frame_n : 0;
+    return score;
+}
+
+// Within budget beats over it, then lower energy, then fewer bad frames
+static int isBetter(const DC_Score *a, const DC_Score *b)
+{
+    int a_fits = a->bad <= g_budget;
+    int b_fits = b->bad <= g_budget;
+
+    if (a_fits != b_fits)
+        return a_fits;
+    if (!a_fits)
+        return a->bad < b->bad;
+    if (a->energy != b->energy)
+        return a->energy < b->energy;
+    return a->bad < b->bad;
+}
+
+static void printParams(const char *label, const DC_Params *params, const DC_Score *score)
+{
+    printf("%-8s drop %5ld us  up %3ld  down %4ld  ->  %s %5.2f %%  %6.2f mJ/frame\n",
+           label, params->drop_frametime_diff, params->frame_n_cooldown_up,
+           params->frame_n_cooldown_down, g_metric_name[g_metric], score->bad, score->energy);
+}
+
+static void searchGrid(DC_Params *best, DC_Score *best_score)
+{
+    int first = 1;
+
+    for (unsigned d = 0; d < sizeof(g_grid_drop) / sizeof(g_grid_drop[0]); d++) {
+        for (unsigned u = 0; u < sizeof(g_grid_up) / sizeof(g_grid_up[0]); u++) {
+            for (unsigned w = 0; w < sizeof(g_grid_down) / sizeof(g_grid_down[0]); w++) {
+                DC_Params params = {g_grid_drop[d], g_grid_up[u], g_grid_down[w]};
+                DC_Score score = evaluate(&params);
+
+                if (first || isBetter(&score, best_score)) {
+                    *best = params;
+                    *best_score = score;
+                    first = 0;
+                }
+            }
+        }
+    }
+}
+
+// Coordinate descent, halves the step of a parameter when neither direction helps
+static void refine(DC_Params *best, DC_Score *best_score)
+{
+    long step[3] = {best->drop_frametime_diff / 4, best->frame_n_cooldown_up / 2, best->frame_n_cooldown_down / 4};
+    long step_min[3] = {250, 1, 5};
+
+    for (int iter = 0; iter < REFINE_MAX; iter++) {
+        int improved = 0;
+
+        for (int p = 0; p < 3; p++) {
+            if (step[p] < step_min[p])
+                step[p] = step_min[p];
+
+            for (int dir = -1; dir <= 1; dir += 2) {
+                DC_Params params = *best;
+                long *value = p == 0 ? &params.drop_frametime_diff :
+                              p == 1 ? &params.frame_n_cooldown_up : &params.frame_n_cooldown_down;
+                *value += dir * step[p];
+                if (*value < step_min[p])
+                    continue;
+
+                DC_Score score = evaluate(&params);
+                if (isBetter(&score, best_score)) {
+                    *best = params;
+                    *best_score = score;
+                    improved = 1;
+                }
+            }
+        }
+
+        if (!improved) {
+            int done = 1;
+            for (int p = 0; p < 3; p++) {
+                if (step[p] > step_min[p]) {
+                    step[p] /= 2;
+                    done = 0;
+                }
+            }
+            if (done)
+                break;
+        }
+    }
+}
+
+// 0 when path holds a profile of the current version
+static int readProfile(const char *path, DC_Profile *profile)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    size_t ret = fread(profile, sizeof(DC_Profile), 1, f);
+    fclose(f);
+
+    if (ret != 1 || profile->magic != PROFILE_MAGIC || profile->version != PROFILE_VERSION)
+        return -1;
+    return 0;
+}
+
+// Tuned values only, merged into the existing profile or left for the device to learn
+static int writeProfile(const char *path, const DC_Params *params)
+{
+    DC_Profile profile;
+
+    if (readProfile(path, &profile) == 0) {
+        printf("merging into %s\n", path);
+    } else {
+        // Nothing learned yet, the governor stays the one chosen on the device
+        memset(&profile, 0, sizeof(profile));
+        profile.magic = PROFILE_MAGIC;
+        profile.version = PROFILE_VERSION;
+        for (int i = 0; i < PROFILE_CLOCK_N; i++) {
+            profile.freq[i] = g_freq_default[i];
+            profile.governor[i] = -1;
+        }
+        profile.calibration_cpu_share = -1;
+        profile.battery_low_percent = PROFILE_BATTERY_LOW_PERCENT;
+        profile.battery_critical_percent = PROFILE_BATTERY_CRITICAL_PERCENT;
+        profile.battery_hot_temp = PROFILE_BATTERY_HOT_TEMP;
+        printf("new profile %s\n", path);
+    }
+    profile.drop_frametime_diff = params->drop_frametime_diff;
+    profile.frame_n_cooldown_up = params->frame_n_cooldown_up;
+    profile.frame_n_cooldown_down = params->frame_n_cooldown_down;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    size_t ret = fwrite(&profile, sizeof(profile), 1, f);
+    fclose(f);
+
+    return ret == 1 ? 0 : -1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: tune [-g ladder|search] [-m stutter|missed] [-b budget_percent] [-n synthetic_n]\n"
+                    "            [-r seed] [-c] [-o TITLEID.bin] [script ...]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL;
+    long synthetic_n = 0;
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+            g_governor = -1;
+            i++;
+            for (int g = 0; g < GOVERNOR_N; g++) {
+                if (!strcasecmp(argv[i], g_governors[g]->name))
+                    g_governor = g;
+            }
+            if (g_governor < 0) {
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            g_metric = -1;
+            i++;
+            for (int m = 0; m < METRIC_N; m++) {
+                if (!strcasecmp(argv[i], g_metric_name[m]))
+                    g_metric = m;
+            }
+            if (g_metric < 0) {
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            g_budget = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            synthetic_n = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-c")) {
+            g_calibrate = 1;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] != '-' && g_session_n < SCRIPT_MAX) {
+            g_phase_n[g_session_n] = loadScript(argv[i], g_phase[g_session_n]);
+            if (g_phase_n[g_session_n] < 0)
+                return 1;
+            g_seed[g_session_n] = seed + g_session_n * 7919;
+            g_session_n++;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    // Variations of the built-in scenarios, same as evaluate
+    if (g_session_n == 0 && synthetic_n == 0)
+        synthetic_n = 20;
+    for (long n = 0; n < synthetic_n && g_session_n < SCRIPT_MAX; n++) {
+        g_seed[g_session_n] = seed + g_session_n * 7919;
+        g_phase_n[g_session_n] = getSyntheticScenario(g_seed[g_session_n], g_phase[g_session_n]);
+        g_session_n++;
+    }
+
+    buildFreqTable();
+
+    DC_Params params = {g_drop_frametime_diff, g_frame_n_cooldown_up, g_frame_n_cooldown_down};
+    DC_Score score = evaluate(&params);
+    printf("%s, %d sessions, %s frame budget %.2f %%\n\n",
+           g_governors[g_governor]->name, g_session_n, g_metric_name[g_metric], g_budget);
+    printParams("current", &params, &score);
+
+    DC_Params best;
+    DC_Score best_score;
+    searchGrid(&best, &best_score);
+    printParams("grid", &best, &best_score);
+
+    refine(&best, &best_score);
+    printParams("refined", &best, &best_score);
+    printf("\n%ld evaluations%s\n", g_eval_n, best_score.bad > g_budget ? ", budget not met" : "");
+
+    if (output && writeProfile(output, &best) < 0)
+        return 1;
+
+    return 0;
+}
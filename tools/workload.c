@@ -0,0 +1,253 @@
+// Synthetic game workload driving the governors, shared by the host tools
+//
+// Script lines (# starts a comment):
+//   name frame_n fps cpu gpu noise spike_every spike_scale
+//
+//   fps          60, 30 or 0 (uncapped, immediate flips)
+//   cpu, gpu     work, frametime = cpu / CPU MHz + gpu / GPU MHz (us)
+//   noise        frametime varies by up to +- noise %
+//   spike_every  every n-th frame is a spike, 0 = none
+//   spike_scale  spike frame work (%)
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "freq.h"
+#include "governor.h"
+#include "pace.h"
+#include "workload.h"
+
+#define VBLANK_US           (SECOND / VBLANK_RATE)
+
+const DC_Scenario g_scenarios[] = {
+    {"mixed",
+        "menu      600 60  800000  600000  5   0   100\n"
+        "loading    20 60 80000000 4000000 10  0   100\n"
+        "steady30 3000 30 5000000 3000000  5   0   100\n"
+        "combat   3000 60 2000000 1800000  8  90   160\n"
+        "steady60 3000 60 2000000 1200000  5   0   100\n"
+        "uncapped 1200  0 4000000 3000000  5   0   100\n"},
+    {"steady30",
+        "steady30 6000 30 5000000 3000000  5   0   100\n"},
+    {"steady60",
+        "steady60 6000 60 2000000 1200000  5   0   100\n"},
+    {"combat",
+        "explore  1800 60 1500000 1200000  5   0   100\n"
+        "combat   3000 60 2000000 1800000  8  90   160\n"
+        "explore  1800 60 1500000 1200000  5   0   100\n"},
+    {"edge",
+        "edge     9000 30 4600000 3400000  3   0   100\n"},
+};
+const int g_scenario_n = sizeof(g_scenarios) / sizeof(g_scenarios[0]);
+
+// Same sequence on every run for a given seed
+static int randomPercent(unsigned int *seed, int range)
+{
+    *seed = *seed * 1103515245 + 12345;
+    if (range <= 0)
+        return 0;
+    return (int)((*seed >> 16) % (2 * range + 1)) - range;
+}
+
+// Num of phases, -1 on error
+int parseScript(const char *script, DC_Phase *phase)
+{
+    char line[128];
+    const char *p = script;
+    int phase_n = 0;
+
+    while (*p && phase_n < PHASE_MAX) {
+        int len = strcspn(p, "\n");
+        if (len >= (int)sizeof(line))
+            len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p += len + (p[len] == '\n');
+
+        DC_Phase *ph = &phase[phase_n];
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+        if (sscanf(line, "%15s %ld %d %ld %ld %d %ld %d", ph->name, &ph->frame_n, &ph->fps,
+                   &ph->cpu, &ph->gpu, &ph->noise, &ph->spike_every, &ph->spike_scale) != 8) {
+            fprintf(stderr, "bad script line: %s\n", line);
+            return -1;
+        }
+        phase_n++;
+    }
+
+    return phase_n > 0 ? phase_n : -1;
+}
+
+int loadScript(const char *path, DC_Phase *phase)
+{
+    char script[4096];
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    size_t len = fread(script, 1, sizeof(script) - 1, f);
+    script[len] = '\0';
+    fclose(f);
+
+    return parseScript(script, phase);
+}
+
+int getScenario(const char *name, DC_Phase *phase)
+{
+    for (int i = 0; i < g_scenario_n; i++) {
+        if (!strcmp(name, g_scenarios[i].name))
+            return parseScript(g_scenarios[i].script, phase);
+    }
+    return -1;
+}
+
+// Built-in scenario picked by seed, CPU/GPU work scaled by 70-130%
+int getSyntheticScenario(unsigned int seed, DC_Phase *phase)
+{
+    seed = seed * 1103515245 + 12345;
+    int phase_n = parseScript(g_scenarios[(seed >> 16) % g_scenario_n].script, phase);
+
+    for (int p = 0; p < phase_n; p++) {
+        seed = seed * 1103515245 + 12345;
+        phase[p].cpu = phase[p].cpu * (70 + (seed >> 16) % 61) / 100;
+        seed = seed * 1103515245 + 12345;
+        phase[p].gpu = phase[p].gpu * (70 + (seed >> 16) % 61) / 100;
+    }
+    return phase_n;
+}
+
+void addStats(DC_Stats *total, const DC_Stats *stats)
+{
+    total->frame_n += stats->frame_n;
+    total->dropped_n += stats->dropped_n;
+    total->stutter_n += stats->stutter_n;
+    total->duration += stats->duration;
+    total->energy += stats->energy;
+    total->transition_n += stats->transition_n;
+    total->oscillation_n += stats->oscillation_n;
+}
+
+// Stand-in for the power API, clocks the governor would have applied
+static void getClocks(int governor, int freq[CLOCK_N], int applied[CLOCK_N])
+{
+    DC_GovernorState state;
+    g_governors[governor]->snapshot(&state);
+
+    for (int i = 0; i < CLOCK_N; i++) {
+        freq[i] = state.freq[i];
+        applied[i] = getCalibrationFreq(i, state.freq[i]);
+    }
+}
+
+// Replay phases on governor from a cold start, phase_stats may be NULL.
+// Frames go through pace.c like in sceDisplaySetFrameBuf_patched, the
+// governor sees the detected target, stats count misses of the scripted one.
+void runWorkload(int governor, const DC_Phase *phase, int phase_n, unsigned int seed, int calibrate,
+                 DC_Stats *phase_stats, DC_Stats *total)
+{
+    int freq[CLOCK_N];
+    int applied[CLOCK_N];
+    int freq_max[CLOCK_N];
+    long long time = 0;     // us since session start
+    long vcount = 0;
+
+    memset(total, 0, sizeof(DC_Stats));
+    for (int i = 0; i < CLOCK_N; i++)
+        freq_max[i] = g_freq_step[i][g_freq_step_n[i] - 1];
+
+    g_oscillation_n = 0;
+    g_calibration_cpu_share = -1;
+    g_governors[governor]->init(NULL);
+    if (calibrate && governor == GOVERNOR_SEARCH)
+        startCalibration(CALIBRATION_FRAME_N_WAIT);
+    startPace(0, 0);
+    getClocks(governor, freq, applied);
+
+    for (int p = 0; p < phase_n; p++) {
+        const DC_Phase *ph = &phase[p];
+        DC_Stats stats;
+        memset(&stats, 0, sizeof(stats));
+
+        long frametime_target = SECOND / (ph->fps > 0 ? ph->fps : g_fps_target_uncapped);
+
+        for (long n = 0; n < ph->frame_n; n++) {
+            float scale = 1.0f + randomPercent(&seed, ph->noise) / 100.0f;
+            if (ph->spike_every > 0 && n % ph->spike_every == ph->spike_every - 1)
+                scale *= ph->spike_scale / 100.0f;
+
+            long work = (long)(scale * ((float)ph->cpu / applied[CLOCK_CPU] +
+                                        (float)ph->gpu / applied[CLOCK_GPU]));
+
+            // Vsynced frames flip on a vblank, never faster than the scripted FPS
+            long frametime;
+            int dropped;
+            if (ph->fps > 0) {
+                long vblank_n_target = VBLANK_RATE / ph->fps;
+                long vcount_flip = (time + work + VBLANK_US - 1) / VBLANK_US;
+                if (vcount_flip < vcount + vblank_n_target)
+                    vcount_flip = vcount + vblank_n_target;
+
+                dropped = vcount_flip - vcount > vblank_n_target;
+                frametime = vcount_flip * VBLANK_US - time;
+                time = vcount_flip * VBLANK_US;
+            } else {
+                dropped = work >= frametime_target + g_drop_frametime_diff;
+                frametime = work;
+                time += work;
+            }
+            vcount = time / VBLANK_US;
+
+            stats.frame_n++;
+            stats.dropped_n += dropped;
+            stats.stutter_n += frametime >= 2 * frametime_target;
+            stats.duration += frametime;
+            stats.energy += (long long)estimatePower(applied) * frametime / 1000;
+
+            DC_PaceFrame pace;
+            measurePace((uint32_t)time, vcount, ph->fps == 0, &pace);
+            int changed = 0;
+            if (stepPace(&pace) & PACE_RESET) {
+                g_governors[governor]->on_suspend();
+                suspendCalibration();
+                changed = 1;
+            }
+            updatePaceTarget(&pace, isCalibrating());
+
+            DC_Frame frame;
+            frame.frametime = pace.real_frametime;
+            frame.frametime_target = g_frametime_target;
+            frame.exact = g_uncapped || !g_frametime_vblank;
+            frame.dropped = isPaceDropped(&pace, g_frametime_target + g_drop_frametime_diff);
+            for (int i = 0; i < CLOCK_N; i++) {
+                frame.freq[i] = freq[i];
+                frame.freq_min[i] = g_freq_dynamic_min[i];
+                frame.freq_max[i] = freq_max[i];
+            }
+
+            // Loading frames aren't fed to governors, as in the hook
+            if (!g_loading && isCalibrating()) {
+                changed |= stepCalibration(&frame);
+            } else if (!g_loading && pace.frametime < g_loading_frametime) {
+                if (isCalibrationPending())
+                    stepCalibration(&frame);
+                changed |= g_governors[governor]->on_frame(&frame);
+            }
+            endPace((uint32_t)time, (uint32_t)time, vcount);
+
+            if (changed) {
+                int applied_old[CLOCK_N];
+                memcpy(applied_old, applied, sizeof(applied_old));
+                getClocks(governor, freq, applied);
+                stats.transition_n += memcmp(applied_old, applied, sizeof(applied_old)) != 0;
+            }
+        }
+
+        if (phase_stats)
+            phase_stats[p] = stats;
+        addStats(total, &stats);
+    }
+
+    total->oscillation_n = g_oscillation_n;
+}
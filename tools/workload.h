@@ -0,0 +1,43 @@
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+#define PHASE_MAX           32
+
+typedef struct {
+    char name[16];
+    long frame_n;
+    int fps;
+    long cpu;
+    long gpu;
+    int noise;
+    long spike_every;
+    int spike_scale;
+} DC_Phase;
+
+typedef struct {
+    long frame_n;
+    long dropped_n;         // missed target
+    long stutter_n;         // took at least twice the target
+    long long duration;     // us
+    long long energy;       // uJ
+    long transition_n;
+    long oscillation_n;
+} DC_Stats;
+
+typedef struct {
+    const char *name;
+    const char *script;
+} DC_Scenario;
+
+extern const DC_Scenario g_scenarios[];
+extern const int g_scenario_n;
+
+int parseScript(const char *script, DC_Phase *phase);
+int loadScript(const char *path, DC_Phase *phase);
+int getScenario(const char *name, DC_Phase *phase);
+int getSyntheticScenario(unsigned int seed, DC_Phase *phase);
+void addStats(DC_Stats *total, const DC_Stats *stats);
+void runWorkload(int governor, const DC_Phase *phase, int phase_n, unsigned int seed, int calibrate,
+                 DC_Stats *phase_stats, DC_Stats *total);
+
+#endif
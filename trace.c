@@ -0,0 +1,57 @@
+#include <psp2/types.h>
+#include "datafile.h"
+#include "trace.h"
+
+#define TRACE_RECORD_N 1024 // ~17s at 60 FPS, flushed every watchdog tick
+
+// Display hook only writes, watchdog thread only reads
+static DC_TraceRecord g_trace[TRACE_RECORD_N];
+static volatile uint32_t g_trace_head = 0;  // next record to write
+static volatile uint32_t g_trace_tail = 0;  // next record to flush
+static int g_trace_started            = 0;  // file created this session
+
+// Dropped when the watchdog thread falls behind, never blocks the hook
+void addTraceRecord(const DC_TraceRecord *record)
+{
+    uint32_t head = g_trace_head;
+    if (head - g_trace_tail >= TRACE_RECORD_N)
+        return;
+
+    g_trace[head % TRACE_RECORD_N] = *record;
+    __sync_synchronize();
+    g_trace_head = head + 1;
+}
+
+// Appends records since last flush to ux0:data/DynClockVita/<titleid>_trace.bin
+int flushTrace(const char *titleid)
+{
+    uint32_t head = g_trace_head;
+    uint32_t tail = g_trace_tail;
+    __sync_synchronize();
+    if (head == tail && g_trace_started)
+        return 0;
+
+    int ret = 0;
+    if (!g_trace_started) {
+        DC_TraceHeader header = {TRACE_MAGIC, TRACE_VERSION, sizeof(DC_TraceRecord)};
+        ret = writeDataFile(titleid, "_trace.bin", &header, sizeof(header));
+        if (ret < 0)
+            return ret;
+        g_trace_started = 1;
+    }
+
+    // Contiguous runs, the ring may wrap once
+    while (ret == 0 && tail != head) {
+        uint32_t index = tail % TRACE_RECORD_N;
+        uint32_t n = head - tail;
+        if (n > TRACE_RECORD_N - index)
+            n = TRACE_RECORD_N - index;
+
+        ret = appendDataFile(titleid, "_trace.bin", &g_trace[index], n * sizeof(DC_TraceRecord));
+        tail += n;
+    }
+
+    __sync_synchronize();
+    g_trace_tail = tail;
+    return ret;
+}
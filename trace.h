@@ -0,0 +1,36 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#define TRACE_MAGIC     0x52544344 // DCTR
+#define TRACE_VERSION   1
+#define TRACE_CLOCK_N   3
+
+#define TRACE_DROPPED       0x01 // missed vsync or took longer than target
+#define TRACE_LOADING       0x02 // loading screen, governors not fed
+#define TRACE_CALIBRATING   0x04 // calibration sweep in progress
+#define TRACE_UNCAPPED      0x08 // immediate flips, no vsync
+
+// File starts with the header, records follow until end of file
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;               // sizeof(DC_TraceRecord)
+} DC_TraceHeader;
+
+// One presented frame, written by sceDisplaySetFrameBuf_patched
+typedef struct {
+    uint32_t tick;                      // frame presented (us, process time, wraps)
+    uint32_t frametime;                 // since previous frame was presented (us)
+    uint16_t hook_time;                 // spent in the display hook, overlay included (us)
+    uint16_t freq[TRACE_CLOCK_N];       // applied clocks after the hook (CPU, BUS, GPU)
+    uint8_t flags;                      // TRACE_*
+    uint8_t reason;                     // DC_Reason of a clock change this frame, 0 = none
+    uint8_t fps_target;
+    uint8_t governor;                   // g_governors index that changed clocks, 0xFF = none
+} DC_TraceRecord;
+
+// Frame recording, builds with ENABLE_TRACE only
+void addTraceRecord(const DC_TraceRecord *record);
+int flushTrace(const char *titleid);
+
+#endif